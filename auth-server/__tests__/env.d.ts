@@ -2,6 +2,7 @@ declare module 'cloudflare:test' {
   interface ProvidedEnv {
     DB: D1Database;
     KV: KVNamespace;
+    INGEST_TOKENS: string;
     TEST_MIGRATIONS: D1Migration[];
   }
 }
@@ -0,0 +1,343 @@
+import { env } from 'cloudflare:test';
+import { schema } from '@/database';
+import app from '@/index';
+import {
+  INGEST_ENVELOPE_VERSION,
+  decodeExportBlock,
+  decodeIngestEnvelope,
+  findIngestUploader,
+  ingestAttendance,
+  readIngestBody,
+  sessionTag,
+} from '@/ingest';
+import { drizzle } from 'drizzle-orm/d1';
+import { afterEach, describe, expect, it } from 'vitest';
+
+// Blocks as the beacon's export encoder writes them for a three-record
+// session 'session-a': records 1-2, record 3, then the empty block that ends
+// the export. Each starts with the format version and the session's tag.
+const SESSION_A_TAG = 0xa36a9d5d;
+const HEADER = [2, 93, 157, 106, 163];
+const FIRST_BLOCK = [
+  ...HEADER, 0, 3, 2, 0, 120, 231, 104, 14, 0, 12, 67, 83, 67, 47, 50, 48, 49,
+  57, 47, 48, 48, 49, 11, 1, 50, 2, 14, 65, 100, 97, 101, 122, 101, 32, 79, 107,
+  111, 110, 107, 119, 111, 11, 84, 117, 110, 100, 101, 32, 66, 101, 108, 108,
+  111, 0, 1,
+];
+const SECOND_BLOCK = [
+  ...HEADER, 2, 3, 1, 3, 120, 231, 104, 0, 12, 67, 83, 67, 47, 50, 48, 49, 57,
+  47, 48, 49, 55, 1, 14, 65, 100, 97, 101, 122, 101, 32, 79, 107, 111, 110,
+  107, 119, 111, 0,
+];
+const END_BLOCK = [...HEADER, 3, 3, 0];
+// The third record as another beacon of a sharded hall numbers it: first.
+const SHARD_BLOCK = [...HEADER, 0, 1, 1, ...SECOND_BLOCK.slice(8)];
+
+interface IngestResponse {
+  success: boolean;
+  message: string;
+  data: { sessions: number; received: number; inserted: number };
+}
+
+function envelope(
+  sessions: { id: string; blocks: number[][] }[],
+): Uint8Array {
+  const bytes: number[] = [INGEST_ENVELOPE_VERSION];
+  for (const { id, blocks } of sessions) {
+    const idBytes = new TextEncoder().encode(id);
+    bytes.push(idBytes.length, ...idBytes, blocks.length);
+    for (const block of blocks) {
+      bytes.push(block.length, ...block);
+    }
+  }
+  return new Uint8Array(bytes);
+}
+
+async function gzip(bytes: Uint8Array): Promise<Uint8Array> {
+  const stream = new Blob([bytes])
+    .stream()
+    .pipeThrough(new CompressionStream('gzip'));
+  return new Uint8Array(await new Response(stream).arrayBuffer());
+}
+
+function ingest(
+  body: Uint8Array,
+  contentType = 'application/octet-stream',
+  token: string | null = 'token-a',
+) {
+  const headers: Record<string, string> = { 'Content-Type': contentType };
+  if (token) {
+    headers.Authorization = `Bearer ${token}`;
+  }
+  return app.request(
+    '/api/attendance/ingest',
+    { method: 'POST', body, headers },
+    env,
+  );
+}
+
+describe('Attendance ingest', () => {
+  afterEach(async () => {
+    await env.DB.exec('DELETE FROM attendance_records');
+    await env.DB.exec('DELETE FROM attendance_sessions');
+  });
+
+  describe('decodeExportBlock', () => {
+    it('should decode records with shared matric prefixes and names', () => {
+      const block = decodeExportBlock(new Uint8Array(FIRST_BLOCK));
+      expect(block).toEqual({
+        tag: SESSION_A_TAG,
+        total: 3,
+        records: [
+          {
+            sequence: 1,
+            studentName: 'Adaeze Okonkwo',
+            matricNumber: 'CSC/2019/001',
+            timestamp: 1760000000,
+          },
+          {
+            sequence: 2,
+            studentName: 'Tunde Bello',
+            matricNumber: 'CSC/2019/002',
+            timestamp: 1760000007,
+          },
+        ],
+      });
+    });
+
+    it('should number records from the block offset', () => {
+      const block = decodeExportBlock(new Uint8Array(SECOND_BLOCK));
+      expect(block?.records.map((record) => record.sequence)).toEqual([3]);
+      expect(block?.records[0].timestamp).toBe(1760000003);
+    });
+
+    it('should reject truncated or padded blocks', () => {
+      expect(
+        decodeExportBlock(new Uint8Array(FIRST_BLOCK.slice(0, -1))),
+      ).toBeNull();
+      expect(decodeExportBlock(new Uint8Array([...END_BLOCK, 0]))).toBeNull();
+      expect(decodeExportBlock(new Uint8Array([1, 0, 0, 0]))).toBeNull();
+    });
+  });
+
+  describe('decodeIngestEnvelope', () => {
+    it('should group blocks by session', () => {
+      const sessions = decodeIngestEnvelope(
+        envelope([
+          { id: 'session-a', blocks: [FIRST_BLOCK, SECOND_BLOCK, END_BLOCK] },
+          { id: 'session-b', blocks: [] },
+        ]),
+      );
+      expect(sessions?.map((session) => session.sessionId)).toEqual([
+        'session-a',
+        'session-b',
+      ]);
+      expect(sessions?.[0].total).toBe(3);
+      expect(sessions?.[0].records).toHaveLength(3);
+      expect(sessions?.[1].records).toHaveLength(0);
+    });
+
+    it('should tag sessions as the beacon does', () => {
+      expect(sessionTag('session-a')).toBe(SESSION_A_TAG);
+    });
+
+    it('should reject blocks filed under another session', () => {
+      expect(
+        decodeIngestEnvelope(
+          envelope([{ id: 'session-b', blocks: [FIRST_BLOCK] }]),
+        ),
+      ).toBeNull();
+    });
+
+    it('should reject an unknown version or a truncated session', () => {
+      const body = envelope([{ id: 'session-a', blocks: [FIRST_BLOCK] }]);
+      expect(
+        decodeIngestEnvelope(body.subarray(0, body.length - 1)),
+      ).toBeNull();
+      body[0] = INGEST_ENVELOPE_VERSION + 1;
+      expect(decodeIngestEnvelope(body)).toBeNull();
+    });
+  });
+
+  describe('readIngestBody', () => {
+    it('should gunzip and enforce the size limit', async () => {
+      const body = envelope([{ id: 'session-a', blocks: [FIRST_BLOCK] }]);
+      const compressed = await gzip(body);
+      const stream = () => new Blob([compressed]).stream();
+      expect(await readIngestBody(stream(), true)).toEqual(body);
+      expect(await readIngestBody(stream(), true, body.length - 1)).toBeNull();
+    });
+  });
+
+  describe('findIngestUploader', () => {
+    const tokens = 'hall-a:token-a, hall-b:token-b,broken';
+
+    it('should name the uploader whose token matches', async () => {
+      expect(await findIngestUploader(tokens, 'Bearer token-b')).toBe(
+        'hall-b',
+      );
+    });
+
+    it('should reject unknown tokens and other schemes', async () => {
+      expect(await findIngestUploader(tokens, 'Bearer token-c')).toBeNull();
+      expect(await findIngestUploader(tokens, 'Basic token-a')).toBeNull();
+      expect(await findIngestUploader(tokens, 'Bearer broken')).toBeNull();
+      expect(await findIngestUploader(tokens, undefined)).toBeNull();
+      expect(await findIngestUploader(undefined, 'Bearer token-a')).toBeNull();
+    });
+  });
+
+  describe('POST /api/attendance/ingest', () => {
+    const body = envelope([
+      { id: 'session-a', blocks: [FIRST_BLOCK, SECOND_BLOCK, END_BLOCK] },
+    ]);
+
+    it('should store every record of the export', async () => {
+      const res = await ingest(body);
+      expect(res.status).toBe(200);
+      const data = await res.json<IngestResponse>();
+      expect(data).toEqual({
+        success: true,
+        message: 'Attendance ingested',
+        data: { sessions: 1, received: 3, inserted: 3 },
+      });
+
+      const { results } = await env.DB.prepare(
+        'SELECT sequence, matric_number, student_name, marked_at FROM attendance_records WHERE session_id = ? ORDER BY sequence',
+      )
+        .bind('session-a')
+        .all();
+      expect(results).toEqual([
+        {
+          sequence: 1,
+          matric_number: 'CSC/2019/001',
+          student_name: 'Adaeze Okonkwo',
+          marked_at: 1760000000,
+        },
+        {
+          sequence: 2,
+          matric_number: 'CSC/2019/002',
+          student_name: 'Tunde Bello',
+          marked_at: 1760000007,
+        },
+        {
+          sequence: 3,
+          matric_number: 'CSC/2019/017',
+          student_name: 'Adaeze Okonkwo',
+          marked_at: 1760000003,
+        },
+      ]);
+      const session = await env.DB.prepare(
+        'SELECT record_count FROM attendance_sessions WHERE id = ?',
+      )
+        .bind('session-a')
+        .first();
+      expect(session).toEqual({ record_count: 3 });
+    });
+
+    it('should require a known ingest token', async () => {
+      for (const token of [null, 'token-c']) {
+        const res = await ingest(body, 'application/octet-stream', token);
+        expect(res.status).toBe(401);
+      }
+
+      const count = await env.DB.prepare(
+        'SELECT COUNT(*) AS count FROM attendance_sessions',
+      ).first('count');
+      expect(count).toBe(0);
+    });
+
+    it('should record the uploader as the owner', async () => {
+      await ingest(body);
+      const owner = await env.DB.prepare(
+        'SELECT owner FROM attendance_sessions WHERE id = ?',
+      )
+        .bind('session-a')
+        .first('owner');
+      expect(owner).toBe('hall-a');
+    });
+
+    it("should refuse additions to another uploader's session", async () => {
+      await ingest(envelope([{ id: 'session-a', blocks: [FIRST_BLOCK] }]));
+      const res = await ingest(body, 'application/octet-stream', 'token-b');
+      expect(res.status).toBe(409);
+      const data = await res.json<{ data: { sessions: string[] } }>();
+      expect(data.data.sessions).toEqual(['session-a']);
+
+      const count = await env.DB.prepare(
+        'SELECT COUNT(*) AS count FROM attendance_records',
+      ).first('count');
+      expect(count).toBe(2);
+    });
+
+    it('should not add records to a session claimed after the check', async () => {
+      await ingest(envelope([{ id: 'session-a', blocks: [FIRST_BLOCK] }]));
+      const sessions = decodeIngestEnvelope(body);
+      expect(sessions).not.toBeNull();
+
+      const db = drizzle(env.DB, { schema });
+      const inserted = await ingestAttendance(db, 'hall-b', sessions ?? []);
+      expect(inserted).toBe(0);
+
+      const count = await env.DB.prepare(
+        'SELECT COUNT(*) AS count FROM attendance_records',
+      ).first('count');
+      expect(count).toBe(2);
+    });
+
+    it('should merge beacons that number the same marks differently', async () => {
+      await ingest(envelope([{ id: 'session-a', blocks: [FIRST_BLOCK] }]));
+      const res = await ingest(
+        envelope([{ id: 'session-a', blocks: [SHARD_BLOCK, END_BLOCK] }]),
+      );
+      const data = await res.json<IngestResponse>();
+      expect(data.data.inserted).toBe(1);
+
+      const { results } = await env.DB.prepare(
+        'SELECT matric_number FROM attendance_records ORDER BY matric_number',
+      ).all();
+      expect(results.map((row) => row.matric_number)).toEqual([
+        'CSC/2019/001',
+        'CSC/2019/002',
+        'CSC/2019/017',
+      ]);
+    });
+
+    it('should be idempotent per session and student', async () => {
+      await ingest(body);
+      const res = await ingest(await gzip(body), 'application/gzip');
+      expect(res.status).toBe(200);
+      const data = await res.json<IngestResponse>();
+      expect(data.data).toEqual({ sessions: 1, received: 3, inserted: 0 });
+
+      const count = await env.DB.prepare(
+        'SELECT COUNT(*) AS count FROM attendance_records',
+      ).first('count');
+      expect(count).toBe(3);
+    });
+
+    it('should insert only records past an earlier partial upload', async () => {
+      await ingest(envelope([{ id: 'session-a', blocks: [FIRST_BLOCK] }]));
+      const res = await ingest(body);
+      const data = await res.json<IngestResponse>();
+      expect(data.data.inserted).toBe(1);
+    });
+
+    it('should reject a malformed export without writing anything', async () => {
+      const res = await ingest(body.subarray(0, body.length - 2));
+      expect(res.status).toBe(400);
+      const data = await res.json<IngestResponse>();
+      expect(data.message).toBe('Malformed attendance export');
+
+      const count = await env.DB.prepare(
+        'SELECT COUNT(*) AS count FROM attendance_sessions',
+      ).first('count');
+      expect(count).toBe(0);
+    });
+
+    it('should reject other content types', async () => {
+      const res = await ingest(body, 'application/json');
+      expect(res.status).toBe(415);
+    });
+  });
+});
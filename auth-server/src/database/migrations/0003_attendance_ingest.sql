@@ -0,0 +1,16 @@
+CREATE TABLE `attendance_records` (
+	`session_id` text NOT NULL,
+	`sequence` integer NOT NULL,
+	`matric_number` text NOT NULL,
+	`student_name` text NOT NULL,
+	`marked_at` integer NOT NULL,
+	PRIMARY KEY(`session_id`, `matric_number`),
+	FOREIGN KEY (`session_id`) REFERENCES `attendance_sessions`(`id`) ON UPDATE no action ON DELETE no action
+);
+--> statement-breakpoint
+CREATE TABLE `attendance_sessions` (
+	`id` text PRIMARY KEY NOT NULL,
+	`owner` text NOT NULL,
+	`record_count` integer DEFAULT 0 NOT NULL,
+	`last_ingested_at` integer DEFAULT CURRENT_TIMESTAMP NOT NULL
+);
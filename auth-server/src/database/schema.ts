@@ -1,5 +1,10 @@
 import { sql } from 'drizzle-orm';
-import { integer, sqliteTable, text } from 'drizzle-orm/sqlite-core';
+import {
+  integer,
+  primaryKey,
+  sqliteTable,
+  text,
+} from 'drizzle-orm/sqlite-core';
 
 import { newId } from '@/common/id';
 
@@ -13,3 +18,36 @@ export const users = sqliteTable('users', {
     .default(sql`CURRENT_TIMESTAMP`),
   lastLogin: integer('last_login', { mode: 'timestamp' }),
 });
+
+// Sessions as created on a beacon; the ID is the beacon's own session ID.
+export const attendanceSessions = sqliteTable('attendance_sessions', {
+  id: text('id').primaryKey(),
+  // Name of the ingest token that first uploaded the session. Uploads under
+  // any other token are refused.
+  owner: text('owner').notNull(),
+  // Largest record total a beacon has reported for the session.
+  recordCount: integer('record_count').notNull().default(0),
+  lastIngestedAt: integer('last_ingested_at', { mode: 'timestamp' })
+    .notNull()
+    .default(sql`CURRENT_TIMESTAMP`),
+});
+
+// A student is marked at most once per session, so records are keyed by
+// matric number: re-sending an export inserts nothing new, and beacons of a
+// sharded hall, which number the same marks differently, add to each other.
+// Sequence is the record's 1-based position on the beacon that sent it.
+export const attendanceRecords = sqliteTable(
+  'attendance_records',
+  {
+    sessionId: text('session_id')
+      .notNull()
+      .references(() => attendanceSessions.id),
+    sequence: integer('sequence').notNull(),
+    matricNumber: text('matric_number').notNull(),
+    studentName: text('student_name').notNull(),
+    markedAt: integer('marked_at', { mode: 'timestamp' }).notNull(),
+  },
+  (table) => ({
+    pk: primaryKey({ columns: [table.sessionId, table.matricNumber] }),
+  }),
+);
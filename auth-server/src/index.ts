@@ -15,6 +15,14 @@ import {
   sendTransactionalEmail,
   verifyOtp,
 } from '@/helpers';
+import {
+  INGEST_MAX_RECORDS,
+  decodeIngestEnvelope,
+  findForeignSessions,
+  findIngestUploader,
+  ingestAttendance,
+  readIngestBody,
+} from '@/ingest';
 import { AuthCompletionValidator, AuthInitiationValidator } from '@/validators';
 import { newId } from './common/id';
 
@@ -23,6 +31,7 @@ const app = new Hono<{
     DB: D1Database;
     KV: KVNamespace;
     PLUNK_API_KEY: string;
+    INGEST_TOKENS: string;
   };
   Variables: {
     services: {
@@ -146,6 +155,94 @@ const routes = app
       }
     },
   )
+  .post('/api/attendance/ingest', async (c) => {
+    const { logger, db } = c.get('services');
+    const uploader = await findIngestUploader(
+      c.env.INGEST_TOKENS,
+      c.req.header('Authorization'),
+    );
+    if (!uploader) {
+      return c.json(
+        { success: false, message: 'Missing or invalid ingest token' },
+        401,
+      );
+    }
+
+    const contentType = c.req.header('Content-Type') ?? '';
+    const gzip = contentType.startsWith('application/gzip');
+    if (!gzip && !contentType.startsWith('application/octet-stream')) {
+      return c.json(
+        {
+          success: false,
+          message: 'Expected application/octet-stream or application/gzip',
+        },
+        415,
+      );
+    }
+
+    let body: Uint8Array | null;
+    try {
+      const stream = c.req.raw.body ?? new Blob().stream();
+      body = await readIngestBody(stream, gzip);
+    } catch {
+      return c.json({ success: false, message: 'Body is not valid gzip' }, 400);
+    }
+    if (!body) {
+      return c.json({ success: false, message: 'Export is too large' }, 413);
+    }
+
+    const sessions = decodeIngestEnvelope(body);
+    if (!sessions) {
+      return c.json(
+        { success: false, message: 'Malformed attendance export' },
+        400,
+      );
+    }
+    const received = sessions.reduce(
+      (count, session) => count + session.records.length,
+      0,
+    );
+    if (received > INGEST_MAX_RECORDS) {
+      return c.json(
+        {
+          success: false,
+          message: `At most ${INGEST_MAX_RECORDS} records per upload`,
+        },
+        413,
+      );
+    }
+
+    try {
+      const foreign = await findForeignSessions(db, uploader, sessions);
+      if (foreign.length > 0) {
+        return c.json(
+          {
+            success: false,
+            message: 'Sessions belong to another uploader',
+            data: { sessions: foreign },
+          },
+          409,
+        );
+      }
+
+      const inserted = await ingestAttendance(db, uploader, sessions);
+      return c.json({
+        success: true,
+        message: 'Attendance ingested',
+        data: { sessions: sessions.length, received, inserted },
+      });
+    } catch (error) {
+      logger.error({
+        msg: 'error in attendance ingest',
+        error: error as Error,
+        service: 'api',
+      });
+      return c.json(
+        { success: false, message: 'Internal server error' },
+        500,
+      );
+    }
+  })
   .onError((err, c) => {
     const { logger } = c.get('services');
 
@@ -0,0 +1,445 @@
+import { and, inArray, ne, sql } from 'drizzle-orm';
+import type { BatchItem } from 'drizzle-orm/batch';
+import type { DrizzleD1Database } from 'drizzle-orm/d1';
+
+import { schema } from '@/database';
+
+/**
+ * Body of `POST /api/attendance/ingest`: the export blocks read from the
+ * beacon's export characteristic, passed through untouched and grouped by
+ * session. Sent as `application/octet-stream`, or gzip-compressed as
+ * `application/gzip`, with `Authorization: Bearer <token>` for one of the
+ * INGEST_TOKENS.
+ *
+ *   u8       envelope version (INGEST_ENVELOPE_VERSION)
+ *   per session, until the body ends:
+ *     u8       session ID length, then the ID as UTF-8
+ *     varint   number of blocks
+ *     per block: varint length, then the block
+ *
+ * Blocks are decoded as in esp32/lib/attendance_core/include/export_format.h,
+ * and each must carry the tag of the session it is filed under. Varints are
+ * unsigned LEB128.
+ */
+export const INGEST_ENVELOPE_VERSION = 1;
+export const INGEST_MAX_BODY_BYTES = 4 * 1024 * 1024;
+export const INGEST_MAX_RECORDS = 10_000;
+
+// Beacons and lecturers upload with their own bearer token. INGEST_TOKENS
+// lists them as comma-separated `name:token` pairs; the name is stored as
+// the owner of every session first uploaded under that token.
+export const INGEST_TOKEN_SEPARATOR = ',';
+
+const EXPORT_FORMAT_VERSION = 2;
+const SESSION_ID_MAX_LENGTH = 95;
+
+// D1 binds at most 100 parameters per statement. A record row takes four,
+// and the session ID and owner three more.
+const RECORDS_PER_STATEMENT = 24;
+const SESSIONS_PER_LOOKUP = 90;
+
+export interface IngestedRecord {
+  sequence: number;
+  studentName: string;
+  matricNumber: string;
+  timestamp: number;
+}
+
+// FNV-1a over the UTF-8 bytes, as the beacon tags sessions.
+export const sessionTag = (sessionId: string): number => {
+  let hash = 0x811c9dc5;
+  for (const byte of new TextEncoder().encode(sessionId)) {
+    hash ^= byte;
+    hash = Math.imul(hash, 0x01000193);
+  }
+  return hash >>> 0;
+};
+
+export interface IngestedSession {
+  sessionId: string;
+  total: number;
+  records: IngestedRecord[];
+}
+
+const utf8 = new TextDecoder('utf-8', { fatal: true });
+
+const decodeUtf8 = (bytes: Uint8Array): string | null => {
+  try {
+    return utf8.decode(bytes);
+  } catch {
+    return null;
+  }
+};
+
+class ByteReader {
+  private offset = 0;
+
+  constructor(private readonly bytes: Uint8Array) {}
+
+  get done(): boolean {
+    return this.offset >= this.bytes.length;
+  }
+
+  byte(): number | null {
+    return this.offset < this.bytes.length ? this.bytes[this.offset++] : null;
+  }
+
+  bytesOf(length: number): Uint8Array | null {
+    if (this.offset + length > this.bytes.length) {
+      return null;
+    }
+    const slice = this.bytes.subarray(this.offset, this.offset + length);
+    this.offset += length;
+    return slice;
+  }
+
+  // At most seven bytes, so the value stays an exact integer; nothing a
+  // beacon sends comes close.
+  varint(): number | null {
+    let result = 0;
+    let scale = 1;
+    while (this.offset < this.bytes.length && scale <= 2 ** 42) {
+      const byte = this.bytes[this.offset++];
+      result += (byte & 0x7f) * scale;
+      if (byte < 0x80) {
+        return result;
+      }
+      scale *= 128;
+    }
+    return null;
+  }
+
+  uint32(): number | null {
+    const bytes = this.bytesOf(4);
+    if (!bytes) {
+      return null;
+    }
+    return new DataView(bytes.buffer, bytes.byteOffset, 4).getUint32(0, true);
+  }
+
+  string(length: number): string | null {
+    const bytes = this.bytesOf(length);
+    return bytes ? decodeUtf8(bytes) : null;
+  }
+}
+
+/**
+ * Decodes one export block.
+ *
+ * @returns The block's session tag, total and records, or null if it is
+ *   malformed.
+ */
+export const decodeExportBlock = (
+  block: Uint8Array,
+): { tag: number; total: number; records: IngestedRecord[] } | null => {
+  const reader = new ByteReader(block);
+  if (reader.byte() !== EXPORT_FORMAT_VERSION) {
+    return null;
+  }
+  const tag = reader.uint32();
+  const offset = reader.varint();
+  const total = reader.varint();
+  const count = reader.varint();
+  if (tag === null || offset === null || total === null || count === null) {
+    return null;
+  }
+  if (offset + count > total) {
+    return null;
+  }
+  if (count === 0) {
+    return reader.done ? { tag, total, records: [] } : null;
+  }
+
+  const first = reader.uint32();
+  if (first === null) {
+    return null;
+  }
+  const timestamps = [first];
+  for (let i = 1; i < count; i++) {
+    const zigzag = reader.varint();
+    if (zigzag === null) {
+      return null;
+    }
+    const delta = zigzag % 2 === 0 ? zigzag / 2 : -(zigzag + 1) / 2;
+    timestamps.push(timestamps[i - 1] + delta);
+  }
+
+  const matricNumbers: string[] = [];
+  let previous = new Uint8Array(0);
+  for (let i = 0; i < count; i++) {
+    const shared = reader.byte();
+    const length = reader.byte();
+    const suffix = length === null ? null : reader.bytesOf(length);
+    if (shared === null || !suffix || shared > previous.length) {
+      return null;
+    }
+    const matric = new Uint8Array(shared + suffix.length);
+    matric.set(previous.subarray(0, shared));
+    matric.set(suffix, shared);
+    const text = decodeUtf8(matric);
+    if (!text) {
+      return null;
+    }
+    matricNumbers.push(text);
+    previous = matric;
+  }
+
+  const dictionarySize = reader.varint();
+  if (dictionarySize === null) {
+    return null;
+  }
+  const names: string[] = [];
+  for (let entry = 0; entry < dictionarySize; entry++) {
+    const length = reader.byte();
+    const name = length === null ? null : reader.string(length);
+    if (name === null) {
+      return null;
+    }
+    names.push(name);
+  }
+
+  const records: IngestedRecord[] = [];
+  for (let i = 0; i < count; i++) {
+    const index = reader.varint();
+    if (index === null || index >= names.length) {
+      return null;
+    }
+    records.push({
+      sequence: offset + i + 1,
+      studentName: names[index],
+      matricNumber: matricNumbers[i],
+      timestamp: timestamps[i],
+    });
+  }
+  return reader.done ? { tag, total, records } : null;
+};
+
+/**
+ * Decodes an ingest envelope.
+ *
+ * @returns The sessions in the order sent, or null if any part is malformed.
+ */
+export const decodeIngestEnvelope = (
+  body: Uint8Array,
+): IngestedSession[] | null => {
+  const reader = new ByteReader(body);
+  if (reader.byte() !== INGEST_ENVELOPE_VERSION) {
+    return null;
+  }
+
+  const sessions: IngestedSession[] = [];
+  while (!reader.done) {
+    const idLength = reader.byte();
+    if (!idLength || idLength > SESSION_ID_MAX_LENGTH) {
+      return null;
+    }
+    const sessionId = reader.string(idLength);
+    const blockCount = reader.varint();
+    if (!sessionId || blockCount === null) {
+      return null;
+    }
+
+    const tag = sessionTag(sessionId);
+    const session: IngestedSession = { sessionId, total: 0, records: [] };
+    for (let i = 0; i < blockCount; i++) {
+      const length = reader.varint();
+      const block = length === null ? null : reader.bytesOf(length);
+      const decoded = block ? decodeExportBlock(block) : null;
+      if (!decoded || decoded.tag !== tag) {
+        return null;
+      }
+      session.total = Math.max(session.total, decoded.total);
+      session.records.push(...decoded.records);
+    }
+    sessions.push(session);
+  }
+  return sessions;
+};
+
+/**
+ * Reads a request body, gunzipping it if asked, and gives up once it grows
+ * past `limit` bytes.
+ *
+ * @returns The body, or null if it is too large.
+ */
+export const readIngestBody = async (
+  body: ReadableStream<Uint8Array>,
+  gzip: boolean,
+  limit = INGEST_MAX_BODY_BYTES,
+): Promise<Uint8Array | null> => {
+  const stream = gzip
+    ? body.pipeThrough(new DecompressionStream('gzip'))
+    : body;
+  const reader = stream.getReader();
+  const chunks: Uint8Array[] = [];
+  let length = 0;
+  for (;;) {
+    const { done, value } = await reader.read();
+    if (done) {
+      break;
+    }
+    length += value.length;
+    if (length > limit) {
+      await reader.cancel();
+      return null;
+    }
+    chunks.push(value);
+  }
+
+  const result = new Uint8Array(length);
+  let offset = 0;
+  for (const chunk of chunks) {
+    result.set(chunk, offset);
+    offset += chunk.length;
+  }
+  return result;
+};
+
+const sha256 = async (text: string): Promise<Uint8Array> =>
+  new Uint8Array(
+    await crypto.subtle.digest('SHA-256', new TextEncoder().encode(text)),
+  );
+
+/**
+ * Matches an `Authorization` header against the configured ingest tokens.
+ * Every token is compared, by digest and in constant time, so the response
+ * time says nothing about how close a guess was.
+ *
+ * @returns The name of the matching token, or null.
+ */
+export const findIngestUploader = async (
+  tokens: string | undefined,
+  authorization: string | undefined,
+): Promise<string | null> => {
+  const match = /^Bearer (\S+)$/.exec(authorization ?? '');
+  if (!tokens || !match) {
+    return null;
+  }
+  const presented = await sha256(match[1]);
+
+  let uploader: string | null = null;
+  for (const entry of tokens.split(INGEST_TOKEN_SEPARATOR)) {
+    const split = entry.indexOf(':');
+    const name = entry.slice(0, split).trim();
+    const token = entry.slice(split + 1).trim();
+    if (split <= 0 || !name || !token) {
+      continue;
+    }
+    const expected = await sha256(token);
+    let difference = 0;
+    for (let i = 0; i < expected.length; i++) {
+      difference |= expected[i] ^ presented[i];
+    }
+    if (difference === 0) {
+      uploader = name;
+    }
+  }
+  return uploader;
+};
+
+/**
+ * @returns The IDs of the given sessions that another uploader owns.
+ */
+export const findForeignSessions = async (
+  db: DrizzleD1Database<typeof schema>,
+  owner: string,
+  sessions: IngestedSession[],
+): Promise<string[]> => {
+  const { attendanceSessions } = schema;
+  const ids = sessions.map((session) => session.sessionId);
+  const foreign: string[] = [];
+  for (let i = 0; i < ids.length; i += SESSIONS_PER_LOOKUP) {
+    const batch = ids.slice(i, i + SESSIONS_PER_LOOKUP);
+    const rows = await db
+      .select({ id: attendanceSessions.id })
+      .from(attendanceSessions)
+      .where(
+        and(
+          inArray(attendanceSessions.id, batch),
+          ne(attendanceSessions.owner, owner),
+        ),
+      );
+    foreign.push(...rows.map((row) => row.id));
+  }
+  return foreign;
+};
+
+/**
+ * Writes decoded sessions and their records in one D1 batch, which runs as a
+ * single transaction. A student already recorded for a session is left as
+ * they are, so a repeated upload is a no-op. New sessions are owned by
+ * `owner`. Callers check with findForeignSessions first to report a
+ * conflict, but the batch checks again: a session claimed by someone else in
+ * the meantime does not change hands, and its records are only inserted
+ * while `owner` holds it.
+ *
+ * @returns How many records were new.
+ */
+export const ingestAttendance = async (
+  db: DrizzleD1Database<typeof schema>,
+  owner: string,
+  sessions: IngestedSession[],
+): Promise<number> => {
+  const { attendanceRecords, attendanceSessions } = schema;
+  const now = new Date();
+  const statements: BatchItem<'sqlite'>[] = [];
+
+  for (const session of sessions) {
+    statements.push(
+      db
+        .insert(attendanceSessions)
+        .values({
+          id: session.sessionId,
+          owner,
+          recordCount: session.total,
+          lastIngestedAt: now,
+        })
+        .onConflictDoUpdate({
+          target: attendanceSessions.id,
+          set: {
+            recordCount: sql`max(${attendanceSessions.recordCount}, excluded.record_count)`,
+            lastIngestedAt: now,
+          },
+          setWhere: sql`${attendanceSessions.owner} = excluded.owner`,
+        }),
+    );
+  }
+  const sessionStatements = statements.length;
+
+  for (const session of sessions) {
+    for (let i = 0; i < session.records.length; i += RECORDS_PER_STATEMENT) {
+      const rows = session.records
+        .slice(i, i + RECORDS_PER_STATEMENT)
+        .map(
+          (record) =>
+            sql`(${record.sequence}, ${record.matricNumber}, ${record.studentName}, ${record.timestamp})`,
+        );
+      // An insert-select, so the owner is checked by the statement that
+      // writes. Drizzle's insert builder only takes literal rows.
+      statements.push(
+        db.all(sql`
+          insert into ${attendanceRecords}
+            (session_id, sequence, matric_number, student_name, marked_at)
+          select ${session.sessionId}, column1, column2, column3, column4
+          from (values ${sql.join(rows, sql`, `)})
+          where exists (
+            select 1 from ${attendanceSessions}
+            where ${attendanceSessions.id} = ${session.sessionId}
+              and ${attendanceSessions.owner} = ${owner}
+          )
+          on conflict do nothing
+          returning sequence
+        `),
+      );
+    }
+  }
+
+  if (statements.length === 0) {
+    return 0;
+  }
+  const [first, ...rest] = statements;
+  const results = await db.batch([first, ...rest]);
+  return results
+    .slice(sessionStatements)
+    .reduce((inserted, rows) => inserted + (rows as unknown[]).length, 0);
+};
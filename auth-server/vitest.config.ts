@@ -26,7 +26,10 @@ export default defineWorkersConfig(async () => {
           miniflare: {
             kvNamespaces: ['KV'],
             d1Databases: ['DB'],
-            bindings: { TEST_MIGRATIONS: migrations },
+            bindings: {
+              TEST_MIGRATIONS: migrations,
+              INGEST_TOKENS: 'hall-a:token-a,hall-b:token-b',
+            },
           },
           wrangler: { configPath: './wrangler.toml' },
         },
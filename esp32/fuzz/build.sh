@@ -0,0 +1,20 @@
+#!/bin/sh
+# Builds the libFuzzer harnesses against lib/attendance_core with clang.
+# ArduinoJson comes from the native environment's dependencies, so run
+# `pio pkg install -e native` once first.
+#
+#   fuzz/build.sh && fuzz/out/fuzz_wire_format -max_total_time=60
+set -e
+
+cd "$(dirname "$0")/.."
+CORE=lib/attendance_core
+ARDUINOJSON=${ARDUINOJSON:-.pio/libdeps/native/ArduinoJson/src}
+CXX=${CXX:-clang++}
+FLAGS="-std=gnu++17 -g -O1 -fsanitize=fuzzer,address,undefined -I$CORE/include -I$ARDUINOJSON"
+
+mkdir -p fuzz/out
+for harness in fuzz/fuzz_*.cpp; do
+    name=$(basename "$harness" .cpp)
+    echo "building $name"
+    $CXX $FLAGS "$harness" $CORE/src/*.cpp -o "fuzz/out/$name"
+done
@@ -0,0 +1,23 @@
+// Manufacturer data picked up by the passive scan.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "beacon_frames.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    MarkFrame frame;
+    if (decodeMarkFrame(data, size, frame))
+    {
+        // Every view must stay inside the input.
+        const uint8_t *end = data + size;
+        const uint8_t *matric = reinterpret_cast<const uint8_t *>(frame.matricNumber.data);
+        if (matric + frame.matricNumber.length > end || frame.signedData + frame.signedLength > end ||
+            frame.mac + BEACON_MAC_BYTES != end)
+        {
+            __builtin_trap();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,32 @@
+// Journal replay over whatever is on flash, torn tails and all.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "journal_format.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    size_t offset = 0;
+    JournalEntry entry;
+    while (size_t length = decodeJournalEntry(data + offset, size - offset, entry))
+    {
+        JournalSession session;
+        MarkAttendanceMessage mark;
+        WireString sessionId;
+        switch (entry.type)
+        {
+        case JOURNAL_SESSION:
+            decodeJournalSession(entry, session);
+            break;
+        case JOURNAL_MARK:
+            decodeJournalMark(entry, mark);
+            break;
+        case JOURNAL_CLOSE:
+            decodeJournalClose(entry, sessionId);
+            break;
+        }
+        offset += length;
+    }
+    return 0;
+}
@@ -0,0 +1,34 @@
+// JSON writes: create session, mark, page request and time sync.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "json_requests.h"
+#include "session_store.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    const char *json = reinterpret_cast<const char *>(data);
+
+    CreateSessionRequest create;
+    if (decodeCreateSessionRequest(json, size, create) == WRITE_STATUS_OK &&
+        (create.sessionIdLength == 0 || create.sessionIdLength > SESSION_ID_MAX_LEN ||
+         strlen(create.sessionId) > create.sessionIdLength))
+    {
+        __builtin_trap();
+    }
+
+    MarkRequest mark;
+    if (decodeMarkRequest(json, size, mark))
+    {
+        markMessage(mark);
+    }
+
+    PageRequest page;
+    decodePageRequest(json, size, page);
+
+    uint32_t epochSeconds;
+    decodeTimeSync(data, size, epochSeconds);
+    return 0;
+}
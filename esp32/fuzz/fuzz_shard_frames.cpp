@@ -0,0 +1,40 @@
+// ESP-NOW frames from the other beacons of a sharded hall, checked before
+// their MAC is.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "journal_format.h"
+#include "shard_frames.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    ShardFrame frame;
+    size_t signedLength = 0;
+    if (!decodeShardFrame(data, size, frame, signedLength))
+    {
+        return 0;
+    }
+    if (signedLength + SHARD_MAC_BYTES != size)
+    {
+        __builtin_trap();
+    }
+    if (frame.type == SHARD_FRAME_ENTRY)
+    {
+        if (frame.entry + frame.entryLength != data + signedLength)
+        {
+            __builtin_trap();
+        }
+        JournalEntry entry;
+        decodeJournalEntry(frame.entry, frame.entryLength, entry);
+    }
+
+    // What decodes re-encodes to the same signed bytes.
+    uint8_t out[SHARD_FRAME_MAX_BYTES];
+    size_t length = encodeShardFrame(frame, out, sizeof(out));
+    if (length != signedLength || __builtin_memcmp(out, data, length) != 0)
+    {
+        __builtin_trap();
+    }
+    return 0;
+}
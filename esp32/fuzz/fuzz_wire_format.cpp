@@ -0,0 +1,47 @@
+// Binary mark and batch writes, as they arrive over GATT.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "wire_format.h"
+
+static bool sameString(WireString a, WireString b)
+{
+    return a.length == b.length && memcmp(a.data, b.data, a.length) == 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    MarkAttendanceMessage mark;
+    if (decodeMarkAttendance(data, size, mark))
+    {
+        // Whatever decodes must survive a round trip. Bytes after the
+        // matric number's NUL are padding, so compare fields, not buffers.
+        uint8_t encoded[WIRE_MARK_MAX_BYTES];
+        size_t length = encodeMarkAttendance(mark, encoded, sizeof(encoded));
+        MarkAttendanceMessage again;
+        if (length != size || !decodeMarkAttendance(encoded, length, again) ||
+            !sameString(mark.sessionId, again.sessionId) || !sameString(mark.name, again.name) ||
+            !sameString(mark.matricNumber, again.matricNumber) || mark.timestamp != again.timestamp)
+        {
+            __builtin_trap();
+        }
+    }
+
+    MarkBatch batch;
+    if (decodeMarkBatch(data, size, batch))
+    {
+        size_t pos = 0;
+        size_t records = 0;
+        while (nextBatchRecord(batch, pos, mark))
+        {
+            ++records;
+        }
+        if (records != batch.count)
+        {
+            __builtin_trap();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+// Milestones on the way from reset to a fully restored beacon, timed from
+// esp_timer start (just before app_main), so ROM and bootloader time is not
+// included.
+enum BootMilestone : uint8_t
+{
+    BOOT_BLE_READY,
+    BOOT_ADVERTISING,
+    BOOT_RESTORED,
+    BOOT_MILESTONE_COUNT,
+};
+
+void recordBootMilestone(BootMilestone milestone);
+
+// Milliseconds after boot the milestone was reached, or 0 if it has not been.
+uint32_t bootMilestoneMillis(BootMilestone milestone);
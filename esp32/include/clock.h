@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+
+// Milliseconds since boot. Backed by the 64-bit esp_timer, so unlike
+// millis() it does not wrap.
+uint64_t monotonicMillis();
+
+// Wall-clock time, see epoch_clock.h. Between syncs it never runs backwards.
+
+// Authoritative sync from the lecturer's phone via the time-sync
+// characteristic. Always applied, even if it moves time back.
+void syncEpoch(uint32_t epochSeconds);
+
+// Fallback anchor from a client timestamp. Only the first one before a sync
+// counts; later ones never move the clock. Returns true when it anchors.
+bool observeEpoch(uint32_t epochSeconds);
+
+bool isClockSynced();
+
+// Current epoch seconds. False until the clock has been synced or anchored.
+bool currentEpoch(uint32_t &epochSeconds);
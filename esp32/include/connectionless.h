@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "wire_format.h"
+#include "write_status.h"
+
+// Connectionless marking. The beacon rotates the active sessions through its
+// scan response as session frames and passively scans for mark frames from
+// students' phones (see beacon_frames.h), so a student can be marked without
+// a GATT connection.
+//
+// Off by default: no app broadcasts mark frames yet, and while it is on the
+// name leaves the scan response, the service UUID leaves the advertisement
+// and the radio spends part of its time scanning. Build with
+// -DCONNECTIONLESS_MARKING=1 and -DBEACON_MARK_KEY=\"...\", the key the
+// student app is provisioned with. A student needs only that key and the
+// session tag from the scan response to sign a mark, never a connection.
+//
+// A mark frame has no room for the student's name, so records marked this
+// way are stored, exported and sent as deltas with an empty name; the
+// lecturer's roster supplies it from the matric number.
+#ifndef CONNECTIONLESS_MARKING
+#define CONNECTIONLESS_MARKING 0
+#endif
+
+// How long each session stays in the scan response.
+#ifndef BEACON_ROTATE_MS
+#define BEACON_ROTATE_MS 1000
+#endif
+
+// Mark frames stamped further than this from the synced clock are dropped.
+#ifndef BEACON_MARK_MAX_SKEW_S
+#define BEACON_MARK_MAX_SKEW_S 300
+#endif
+
+// Applies a verified mark, as the mark-attendance characteristics do.
+// Called on the NimBLE host task without StoreLock held.
+typedef WriteStatus (*ConnectionlessMarkHandler)(const MarkAttendanceMessage &message);
+
+// Sets the advertising payload up for session frames and starts scanning.
+// Call after the GATT service is started, before advertising.
+void startConnectionless(const char *deviceName, ConnectionlessMarkHandler handler);
+
+// Changes the mark-frame scan timing, in ms. A window of 0 stops the scan
+// until it is set again. Called from loop().
+void setConnectionlessScan(uint16_t intervalMs, uint16_t windowMs);
+
+// Rotates the session frame and restarts the scan if the stack stopped it.
+// Called from loop().
+void serviceConnectionless();
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "session_store.h"
+#include "wire_format.h"
+#include "write_status.h"
+
+// Per-central state for up to CONFIG_BT_NIMBLE_MAX_CONNECTIONS concurrent
+// connections, keyed by connection handle.
+#ifndef CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+#define CONFIG_BT_NIMBLE_MAX_CONNECTIONS 3
+#endif
+#define MAX_CONNECTIONS CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+
+// Token bucket applied to every student write: a short burst, then a steady
+// rate. Persistent connections are not limited.
+#ifndef WRITE_RATE_BURST
+#define WRITE_RATE_BURST 8
+#endif
+#ifndef WRITE_RATE_PER_SECOND
+#define WRITE_RATE_PER_SECOND 4
+#endif
+
+// Student connections are dropped this long after a mark is acknowledged,
+// or after this long without a write. Zero disables either policy.
+// Persistent connections (lecturer devices) are exempt from both.
+#ifndef POST_MARK_DISCONNECT_MS
+#define POST_MARK_DISCONNECT_MS 500
+#endif
+#ifndef IDLE_DISCONNECT_MS
+#define IDLE_DISCONNECT_MS 20000
+#endif
+
+#define DEFAULT_ATT_MTU 23
+
+// Cursor for the paged attendance read. A page request write positions it,
+// every page read advances it past the records that were returned. The
+// request either names a record offset ("cursor") or the last sequence
+// number the client already holds ("since").
+struct PageCursor
+{
+    char sessionId[SESSION_ID_MAX_LEN + 1];
+    size_t offset;
+};
+
+struct ConnectionContext
+{
+    bool inUse;
+    uint16_t connHandle;
+    uint16_t mtu;
+    bool persistent;
+    PageCursor page;
+    // Status readback for the last batch write, see wire_format.h.
+    uint8_t batchStatus[WIRE_BATCH_STATUS_BYTES];
+    // Last write outcome, see write_status.h.
+    uint8_t writeStatus[WRITE_STATUS_BYTES];
+    bool statusSubscribed;
+    uint32_t tokenMillis;
+    uint64_t lastRefillMillis;
+    uint64_t lastActivityMillis;
+    uint64_t disconnectAtMillis;
+};
+
+ConnectionContext *openConnection(uint16_t connHandle);
+
+void closeConnection(uint16_t connHandle);
+
+ConnectionContext *findConnection(uint16_t connHandle);
+
+size_t connectionCount();
+
+// Consumes one write token and records activity. False means the client is
+// over its rate and the write should be dropped; never for a persistent
+// connection.
+bool takeWriteToken(ConnectionContext &connection);
+
+// Records read activity for the idle policy.
+void touchConnection(ConnectionContext &connection);
+
+// Marks the connection as a lecturer device that must stay up. Returns true
+// the first time, so the caller can switch the link to its radio profile.
+bool markPersistent(ConnectionContext &connection);
+
+// Applies the post-mark disconnect policy to a student connection.
+void scheduleDisconnectAfterMark(ConnectionContext &connection);
+
+// Fills handles with the connections that are due to be dropped now.
+size_t collectDueDisconnects(uint16_t *handles, size_t capacity);
@@ -0,0 +1,8 @@
+#pragma once
+
+// Background task that frees sessions once their expiry time has passed.
+// It sleeps until the earliest scheduled expiry instead of polling.
+void startExpirySweeper();
+
+// Call after scheduling or cancelling an expiry, or when the clock changes.
+void wakeExpirySweeper();
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <NimBLEDevice.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "metrics.h"
+
+// Compile-time description of the attendance service. Each characteristic is
+// one row: UUID, properties and the plain functions that handle it. setup()
+// creates the whole table in one loop, and every read, write and subscribe
+// goes through a single static GattDispatcher, so there is no callback object
+// per characteristic and adding one is a row rather than a class and a new.
+//
+// Handlers own their codec: each decodes its write with one of the decoders
+// in wire_format.h or json_requests.h and reports through the write status.
+
+typedef void (*CharacteristicHandler)(NimBLECharacteristic *characteristic, ble_gap_conn_desc *desc);
+typedef void (*SubscribeHandler)(NimBLECharacteristic *characteristic, ble_gap_conn_desc *desc,
+                                 uint16_t subValue);
+
+struct CharacteristicDescriptor
+{
+    // Index of the row in its table; checked by gattTableIsValid.
+    uint8_t id;
+    const char *name;
+    const char *uuid;
+    uint32_t properties;
+    CharacteristicHandler onWrite;
+    MetricCallback writeMetric;
+    CharacteristicHandler onRead;
+    MetricCallback readMetric;
+    SubscribeHandler onSubscribe;
+};
+
+// Histogram slot of a handler the row leaves out.
+#define GATT_NO_METRIC METRIC_CALLBACK_COUNT
+
+#define GATT_WRITE_PROPERTIES (NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_NR)
+#define GATT_SUBSCRIBE_PROPERTIES (NIMBLE_PROPERTY::NOTIFY | NIMBLE_PROPERTY::INDICATE)
+
+// The checks are recursive single-return functions so they stay constexpr
+// under C++11.
+constexpr bool gattStringsEqual(const char *a, const char *b)
+{
+    return *a == *b && (*a == '\0' || gattStringsEqual(a + 1, b + 1));
+}
+
+// Handlers exist exactly for the properties that need them, and every timed
+// handler names a histogram.
+constexpr bool gattRowIsValid(const CharacteristicDescriptor &row, size_t index)
+{
+    return row.id == index &&
+           ((row.properties & GATT_WRITE_PROPERTIES) != 0) == (row.onWrite != nullptr) &&
+           ((row.properties & NIMBLE_PROPERTY::READ) != 0) == (row.onRead != nullptr) &&
+           (row.onSubscribe == nullptr || (row.properties & GATT_SUBSCRIBE_PROPERTIES) != 0) &&
+           (row.onWrite == nullptr || row.writeMetric < METRIC_CALLBACK_COUNT) &&
+           (row.onRead == nullptr || row.readMetric < METRIC_CALLBACK_COUNT);
+}
+
+constexpr bool gattUuidUnique(const CharacteristicDescriptor *table, size_t count, size_t index, size_t other)
+{
+    return other >= count ||
+           (!gattStringsEqual(table[index].uuid, table[other].uuid) &&
+            gattUuidUnique(table, count, index, other + 1));
+}
+
+constexpr bool gattRowsValid(const CharacteristicDescriptor *table, size_t count, size_t index)
+{
+    return index >= count ||
+           (gattRowIsValid(table[index], index) && gattUuidUnique(table, count, index, index + 1) &&
+            gattRowsValid(table, count, index + 1));
+}
+
+template <size_t N>
+constexpr bool gattTableIsValid(const CharacteristicDescriptor (&table)[N])
+{
+    return N <= UINT8_MAX && gattRowsValid(table, N, 0);
+}
+
+// Routes NimBLE's callbacks to the table's handlers, timing each read and
+// write into its metrics histogram. Characteristics are found by pointer in
+// the array filled by registerCharacteristics, a scan over a few words.
+class GattDispatcher : public NimBLECharacteristicCallbacks
+{
+public:
+    GattDispatcher(const CharacteristicDescriptor *table, NimBLECharacteristic **characteristics, size_t count);
+
+    // Creates every characteristic on the service, in table order.
+    void registerCharacteristics(NimBLEService *service);
+
+    void onRead(NimBLECharacteristic *characteristic, ble_gap_conn_desc *desc) override;
+    void onWrite(NimBLECharacteristic *characteristic, ble_gap_conn_desc *desc) override;
+    void onSubscribe(NimBLECharacteristic *characteristic, ble_gap_conn_desc *desc, uint16_t subValue) override;
+
+private:
+    const CharacteristicDescriptor *find(const NimBLECharacteristic *characteristic) const;
+
+    const CharacteristicDescriptor *table;
+    NimBLECharacteristic **characteristics;
+    size_t count;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "session_store.h"
+
+// Append-only attendance journal on LittleFS, so a reset mid-lecture does not
+// lose the marks taken so far. Entries are framed by journal_format.h and
+// queued in RAM; a background task writes and flushes them in batches, so
+// the BLE path never waits on flash.
+
+#ifndef JOURNAL_BUFFER_BYTES
+#define JOURNAL_BUFFER_BYTES 4096
+#endif
+
+#ifndef JOURNAL_FLUSH_INTERVAL_MS
+#define JOURNAL_FLUSH_INTERVAL_MS 200
+#endif
+
+// A journal longer than this is rewritten from the live tables at boot.
+#ifndef JOURNAL_COMPACT_BYTES
+#define JOURNAL_COMPACT_BYTES (64UL * 1024UL)
+#endif
+
+// Mounts the filesystem and replays the journal into the session table on a
+// background task, then starts the flusher and wakes the expiry sweeper.
+// The table is locked for the duration of the replay. Call once after
+// initStore; BLE can already be up.
+void startJournalRestore();
+
+// False until the replay has finished. Writes that change the table must
+// wait for it, or a mark could race ahead of its session's entry.
+bool isJournalRestored();
+
+// Queue an entry. Callers hold StoreLock, which keeps the journal in the
+// same order as the table changes.
+void journalSession(const SessionSlot &slot);
+void journalMark(const SessionSlot &slot, const AttendanceRecord &record);
+void journalClose(const SessionSlot &slot);
+
+// Encode a slot's session or one of its records as a journal entry, for the
+// shard mesh. Return the length, or 0 if it does not fit in capacity.
+size_t encodeSessionEntry(const SessionSlot &slot, uint8_t *out, size_t capacity);
+size_t encodeMarkEntry(const SessionSlot &slot, const AttendanceRecord &record, uint8_t *out, size_t capacity);
+
+// Entries lost because the queue was full.
+uint32_t journalDropCount();
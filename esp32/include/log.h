@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+
+// Log lines are formatted into a RAM ring buffer and written to Serial by a
+// low-priority task, so BLE callbacks never block on the UART. Levels above
+// LOG_LEVEL compile to nothing, arguments included.
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#ifndef LOG_BUFFER_BYTES
+#define LOG_BUFFER_BYTES 4096
+#endif
+#define LOG_LINE_MAX 160
+
+// Starts the drain task. Lines logged before this are buffered.
+void logInit();
+
+void logWrite(uint8_t level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+// Number of lines dropped because the ring buffer was full.
+uint32_t logDropCount();
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) logWrite(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) logWrite(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) logWrite(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) logWrite(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "write_status.h"
+
+// Runtime counters for the metrics characteristic. Recording is lock-free
+// and cheap enough for every GATT callback.
+//
+// Snapshot layout (little-endian):
+//
+//   u8    format version (METRICS_FORMAT_VERSION)
+//   u32   uptime in seconds
+//   u32   free internal heap, u32 minimum free internal heap since boot,
+//         u32 largest free internal block
+//   u8    open connections
+//   u32   log lines dropped, u32 journal entries dropped
+//   u32   boot milestones in ms: BLE ready, advertising, restored (0 = not yet)
+//   u8    power state (PowerState), u8 flags: bit 0 set if light sleep is on
+//   POWER_STATE_COUNT times: u32 seconds spent in the state, u16 its
+//         estimated average current in mA
+//   u8    outcome count, then for each: u8 operation, u8 status, u32 count.
+//         Only non-zero (operation, status) pairs are listed. Batch writes
+//         count once as WRITE_OP_MARK_BATCH and once per record as
+//         WRITE_OP_MARK.
+//   u8    histogram count, then for each: u8 callback (MetricCallback),
+//         then METRICS_LATENCY_BUCKETS u16 sample counts, saturating. Only
+//         callbacks that have run are listed. Buckets are < 100 us, < 250 us,
+//         < 500 us, < 1 ms, < 2.5 ms, < 5 ms, < 10 ms and the rest.
+//
+// Lists that would overrun the buffer are cut short, with their count
+// byte matching what was written.
+#define METRICS_FORMAT_VERSION 2
+#define METRICS_LATENCY_BUCKETS 8
+#define METRICS_MAX_BYTES 512
+
+// GATT callbacks with a latency histogram.
+enum MetricCallback : uint8_t
+{
+    METRIC_CB_CREATE_SESSION,
+    METRIC_CB_MARK,
+    METRIC_CB_MARK_BINARY,
+    METRIC_CB_MARK_BATCH_WRITE,
+    METRIC_CB_MARK_BATCH_READ,
+    METRIC_CB_WRITE_STATUS_READ,
+    METRIC_CB_TIME_SYNC,
+    METRIC_CB_RETRIEVE_ATTENDANCES,
+    METRIC_CB_RETRIEVE_SESSIONS,
+    METRIC_CB_PAGE_REQUEST,
+    METRIC_CB_PAGE_READ,
+    METRIC_CB_EXPORT_READ,
+    METRIC_CB_METRICS_READ,
+    METRIC_CALLBACK_COUNT,
+};
+
+void recordWriteOutcome(WriteOperation operation, WriteStatus status);
+
+void recordCallbackLatency(MetricCallback callback, uint32_t micros);
+
+// Times the enclosing scope into a callback's histogram.
+class CallbackTimer
+{
+public:
+    explicit CallbackTimer(MetricCallback callback);
+    ~CallbackTimer();
+
+    CallbackTimer(const CallbackTimer &) = delete;
+    CallbackTimer &operator=(const CallbackTimer &) = delete;
+
+private:
+    MetricCallback callback;
+    int64_t startMicros;
+};
+
+// Encodes the current counters. Returns the length, at most capacity.
+size_t encodeMetrics(uint8_t *out, size_t capacity);
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+
+// Duty cycling for battery-powered beacons. While a session is being marked
+// the beacon advertises and scans fast; once marks taper off it backs off,
+// and with no session live it advertises slowly, stops the mark-frame scan
+// and wakes loop() less often. Between radio events the CPU scales down and,
+// where the SDK build allows, the chip light-sleeps with the BLE controller
+// in modem sleep.
+enum PowerState : uint8_t
+{
+    POWER_ACTIVE,
+    POWER_TAPERING,
+    POWER_IDLE,
+    POWER_STATE_COUNT,
+};
+
+struct PowerStateParams
+{
+    const char *name;
+    // Advertising interval bounds in 0.625 ms units.
+    uint16_t minAdvInterval;
+    uint16_t maxAdvInterval;
+    // Passive mark-frame scan in ms; a window of 0 stops the scan.
+    uint16_t scanInterval;
+    uint16_t scanWindow;
+    uint16_t loopIntervalMs;
+    // Rough average supply current in mA, for the metrics. Measure a board
+    // and override these before trusting battery estimates from them.
+    uint16_t estimatedMilliamps;
+};
+
+// How long after the last session start or accepted mark the beacon stays
+// in POWER_ACTIVE.
+#ifndef POWER_ACTIVE_HOLD_MS
+#define POWER_ACTIVE_HOLD_MS 120000
+#endif
+
+// Allow automatic light sleep between events. Needs CONFIG_PM_ENABLE and
+// tickless idle in the SDK build; without them only the CPU clock scales.
+#ifndef POWER_LIGHT_SLEEP
+#define POWER_LIGHT_SLEEP 1
+#endif
+
+#ifndef POWER_MAX_CPU_MHZ
+#define POWER_MAX_CPU_MHZ 240
+#endif
+#ifndef POWER_MIN_CPU_MHZ
+#define POWER_MIN_CPU_MHZ 80
+#endif
+
+const PowerStateParams &powerStateParams(PowerState state);
+
+// Configures frequency scaling and light sleep and applies POWER_ACTIVE.
+// Call after advertising and the mark-frame scan are set up.
+void startPowerManager();
+
+// A session started or a mark was accepted. Safe from any task.
+void notePowerActivity();
+
+// Re-evaluates the state and applies any change. Called from loop().
+void servicePower();
+
+PowerState currentPowerState();
+
+// How long loop() should wait before its next pass in the current state.
+uint16_t powerLoopIntervalMs();
+
+// Seconds spent in each state since boot, including the current one.
+uint32_t powerStateSeconds(PowerState state);
+
+bool isLightSleepEnabled();
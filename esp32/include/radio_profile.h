@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+class NimBLEServer;
+
+// Link-layer settings negotiated per connection. Students hold a link only
+// long enough to mark, so they get a relaxed interval that leaves airtime
+// for other centrals. Lecturer devices pull whole attendance lists, so they
+// get the shortest interval, the largest LL payload and the 2M PHY where the
+// controller supports it.
+enum RadioProfile : uint8_t
+{
+    RADIO_PROFILE_MANY_STUDENTS,
+    RADIO_PROFILE_BURST_SYNC,
+};
+
+struct RadioProfileParams
+{
+    const char *name;
+    // Connection interval bounds in 1.25 ms units.
+    uint16_t minInterval;
+    uint16_t maxInterval;
+    uint16_t latency;
+    // Supervision timeout in 10 ms units.
+    uint16_t timeout;
+    // LL data length to request, 0 keeps the 27-byte default.
+    uint16_t txOctets;
+    bool prefer2M;
+};
+
+const RadioProfileParams &radioProfileParams(RadioProfile profile);
+
+// Requests the profile's connection parameters, data length and PHY. The
+// central may refuse any of them; the link keeps working on what it has.
+void applyRadioProfile(NimBLEServer *server, uint16_t connHandle, RadioProfile profile);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The session list sent to every student phone, serialized once per change
+// of the session table into a static buffer. StoreLock is taken only to
+// regenerate it; otherwise it is served without locking. Call it from the
+// NimBLE host task only, so the buffer has a single reader and writer and a
+// returned view stays valid until the next call.
+// It is served as one characteristic value, which cannot exceed
+// BLE_ATT_ATTR_MAX_LEN, so sessions that do not fit are left off the end.
+#define SESSION_LIST_JSON_MAX 512
+
+struct SessionListJson
+{
+    const char *data;
+    size_t length;
+    uint32_t generation;
+};
+
+SessionListJson sessionListJson();
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "journal_format.h"
+#include "session_store.h"
+
+// Sharded deployment for halls one beacon cannot serve. SHARD_COUNT beacons
+// with the same mesh key share every session: each one journals what it
+// creates and marks as usual and also broadcasts the entry to the others
+// over ESP-NOW (see shard_frames.h), which apply it as if it were their own.
+// A session created on any beacon reaches all of them, a mark taken on one
+// is deduplicated against the rest, and every beacon ends up holding the
+// merged list, so the lecturer can read it from whichever is nearest.
+//
+// Beacons advertise as DEVICE_NAME-<id>of<count>; the app sends each student
+// to shardForMatric's beacon and falls back to the strongest one in range.
+// Wi-Fi stays on for ESP-NOW, so a sharded beacon does not light-sleep.
+//
+// Build every beacon with -DSHARDED_DEPLOYMENT=1, its own -DSHARD_ID, the
+// same -DSHARD_COUNT and -DSHARD_MESH_KEY=\"...\", and the same channel.
+#ifndef SHARDED_DEPLOYMENT
+#define SHARDED_DEPLOYMENT 0
+#endif
+
+#ifndef SHARD_ID
+#define SHARD_ID 0
+#endif
+
+#ifndef SHARD_COUNT
+#define SHARD_COUNT 1
+#endif
+
+// Wi-Fi channel the beacons broadcast on. ESP-NOW only reaches peers on the
+// same one.
+#ifndef SHARD_WIFI_CHANNEL
+#define SHARD_WIFI_CHANNEL 1
+#endif
+
+// Recent outgoing entries kept for peers that missed them. A peer that falls
+// further behind than this skips ahead and logs what it lost.
+#ifndef SHARD_REPLAY_SLOTS
+#define SHARD_REPLAY_SLOTS 32
+#endif
+
+#ifndef SHARD_HEARTBEAT_MS
+#define SHARD_HEARTBEAT_MS 2000
+#endif
+
+// Least time between replay requests to the same peer.
+#ifndef SHARD_RESEND_INTERVAL_MS
+#define SHARD_RESEND_INTERVAL_MS 500
+#endif
+
+// How long a peer's entry may wait on a session that has not arrived before
+// it is skipped.
+#ifndef SHARD_STALL_MS
+#define SHARD_STALL_MS 10000
+#endif
+
+enum ShardApplyResult : uint8_t
+{
+    SHARD_APPLIED,
+    // Cannot apply yet, for example a mark for a session still in flight
+    // from another beacon. Offered again after the next replay.
+    SHARD_RETRY,
+};
+
+// Applies a peer's journal entry. Called from loop() without StoreLock
+// held. Entries arrive in the order their beacon produced them.
+typedef ShardApplyResult (*ShardEntryHandler)(const JournalEntry &entry);
+
+// Brings up Wi-Fi and ESP-NOW. Call from setup() after BLE is up.
+void startShardMesh(ShardEntryHandler handler);
+
+// Queue a locally originated change for the peers. Callers hold StoreLock,
+// as for the journal; entries applied from a peer are never republished.
+void shardPublishSession(const SessionSlot &slot);
+void shardPublishMark(const SessionSlot &slot, const AttendanceRecord &record);
+
+// Applies received entries, sends queued ones and heartbeats, and answers
+// replay requests. Called from loop().
+void serviceShardMesh();
@@ -0,0 +1,35 @@
+#pragma once
+
+// Serialises access to the session table and record pool between the
+// NimBLE host task and the background tasks. Hold it only for the duration
+// of a lookup or update.
+//
+// Who touches the store:
+//   - NimBLE host task: every GATT callback. Creates and marks are short
+//     writes. Page reads copy their records under the lock and serialize
+//     after releasing it. The session list is a cache that takes the lock
+//     only when sessionTableGeneration has moved. The legacy full-list read
+//     still serializes under the lock; it is kept only for old app builds.
+//   - sweeper: evicts expired sessions.
+//   - restore: replays the journal once at boot. Writes are turned away with
+//     a RESTORING status until it finishes, so only reads can wait on it.
+//   - journal flusher: checks under the lock whether the table is empty,
+//     then does its flash work without it.
+//   - loop(): in a sharded deployment, applies the other beacons' sessions
+//     and marks one entry at a time.
+// Otherwise flash I/O, page serialization and BLE notifications, write
+// statuses and mark deltas included, are kept outside the lock. A delta is
+// encoded under it, so sequence numbers follow the append order, and
+// notified after it is released. The mutex has priority inheritance, so a
+// low-priority holder is boosted while the host task waits.
+void initStoreLock();
+
+class StoreLock
+{
+public:
+    StoreLock();
+    ~StoreLock();
+
+    StoreLock(const StoreLock &) = delete;
+    StoreLock &operator=(const StoreLock &) = delete;
+};
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "store_capacity.h"
+
+// Plans the store against the configured budget and the free internal heap,
+// allocates the session table and record pool and hands them to the store.
+// Call once at boot, before NimBLE takes its share of the heap. If an
+// allocation fails the budget is shrunk and the plan retried; if PSRAM keeps
+// failing, records fall back to the internal-only plan.
+StoreCapacity initStore();
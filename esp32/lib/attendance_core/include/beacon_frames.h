@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "wire_format.h"
+
+// Manufacturer-specific advertising payloads for connectionless marking.
+// Both start with the company ID, little-endian. 0xFFFF is the ID the
+// Bluetooth SIG sets aside for testing.
+//
+// Session frame, in the beacon's scan response. One session per frame; the
+// beacon rotates through the table.
+//
+//   u16      company ID
+//   u8       frame type (BEACON_FRAME_SESSION)
+//   u8       low byte of the session table generation
+//   u8       index of this session, u8 session count
+//   u32      session tag (FNV-1a of the session ID)
+//   u16      minutes until expiry, 0xFFFF if the beacon has no clock yet
+//   N bytes  course code, the rest of the frame
+//
+// Mark frame, broadcast by a student's phone and picked up by scanning.
+//
+//   u16      company ID
+//   u8       frame type (BEACON_FRAME_MARK)
+//   u32      session tag
+//   u32      timestamp (epoch seconds)
+//   M bytes  matric number, the rest of the frame less the MAC
+//   4 bytes  first bytes of HMAC-SHA256 over frame type through matric,
+//            keyed with the hall's provisioned mark key
+//
+// A legacy advertisement carries at most 29 bytes of manufacturer data, so
+// a mark frame fits matric numbers of up to BEACON_MARK_MATRIC_MAX bytes and
+// carries no name.
+#define BEACON_COMPANY_ID 0xFFFF
+#define BEACON_FRAME_SESSION 0x01
+#define BEACON_FRAME_MARK 0x02
+#define BEACON_MANUFACTURER_MAX 29
+#define BEACON_MAC_BYTES 4
+#define BEACON_MARK_MATRIC_MAX (BEACON_MANUFACTURER_MAX - 2 - 1 - 4 - 4 - BEACON_MAC_BYTES)
+#define BEACON_EXPIRY_UNKNOWN 0xFFFF
+
+struct SessionFrame
+{
+    uint8_t generation;
+    uint8_t index;
+    uint8_t count;
+    uint32_t sessionTag;
+    uint16_t minutesToExpiry;
+    WireString courseCode;
+};
+
+// Decoded view of a mark frame. Pointers refer to the decoded buffer.
+struct MarkFrame
+{
+    uint32_t sessionTag;
+    uint32_t timestamp;
+    WireString matricNumber;
+    const uint8_t *signedData;
+    size_t signedLength;
+    const uint8_t *mac;
+};
+
+// Returns the encoded length; the course code is cut to fit capacity and
+// BEACON_MANUFACTURER_MAX.
+size_t encodeSessionFrame(const SessionFrame &frame, uint8_t *out, size_t capacity);
+
+// Returns false unless this is a mark frame under our company ID with a
+// 1..BEACON_MARK_MATRIC_MAX byte matric number.
+bool decodeMarkFrame(const uint8_t *data, size_t length, MarkFrame &out);
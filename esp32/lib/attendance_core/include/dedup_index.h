@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "record_pool.h"
+
+// Open-addressed set of the matric numbers already marked in one session.
+// Entries are recordHandle() + 1 so zero means empty; the table is at least
+// twice MAX_RECORDS_PER_SESSION, which keeps linear probes short.
+#ifndef DEDUP_INDEX_SLOTS
+#define DEDUP_INDEX_SLOTS 1024
+#endif
+
+static_assert((DEDUP_INDEX_SLOTS & (DEDUP_INDEX_SLOTS - 1)) == 0, "DEDUP_INDEX_SLOTS must be a power of two");
+static_assert(DEDUP_INDEX_SLOTS >= 2 * MAX_RECORDS_PER_SESSION, "DEDUP_INDEX_SLOTS must be at least twice MAX_RECORDS_PER_SESSION");
+
+struct DedupIndex
+{
+    uint16_t slots[DEDUP_INDEX_SLOTS];
+};
+
+void clearDedupIndex(DedupIndex &index);
+
+// Returns the entry for this matric number: non-zero if it is already
+// marked, otherwise the empty entry to fill with markDedupEntry(). length
+// must not exceed RECORD_MATRIC_MAX_LEN.
+uint16_t *findDedupEntry(DedupIndex &index, const char *matricNumber, size_t length);
+
+inline void markDedupEntry(uint16_t *entry, const AttendanceRecord *record)
+{
+    *entry = recordHandle(record) + 1;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+// Wall-clock time kept as an offset from a monotonic millisecond count. The
+// caller supplies the count and serialises access; clock.h wraps one of
+// these around esp_timer for the firmware.
+//
+// Until the lecturer's phone syncs it, the clock is anchored once from the
+// first student timestamp and then left alone: one phone with a fast clock,
+// or a forged mark, must not be able to push time forward and expire every
+// session. A sync always applies, backwards included. Between syncs the
+// clock never reads lower than it last did.
+struct EpochClock
+{
+    bool anchored;
+    bool synced;
+    // Epoch milliseconds minus the monotonic count.
+    int64_t offsetMillis;
+    // Latest epoch milliseconds handed out since the last sync.
+    int64_t floorMillis;
+};
+
+void resetEpochClock(EpochClock &clock);
+
+void syncEpochClock(EpochClock &clock, uint32_t epochSeconds, uint64_t nowMillis);
+
+// Returns true if this observation anchored the clock.
+bool observeEpochClock(EpochClock &clock, uint32_t epochSeconds, uint64_t nowMillis);
+
+// False until the clock has been synced or anchored.
+bool readEpochClock(EpochClock &clock, uint64_t nowMillis, uint32_t &epochSeconds);
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "session_store.h"
+
+// Indexed binary min-heap of session slots ordered by expiry time. Each slot
+// appears at most once, so rescheduling or cancelling a session is
+// O(log STORE_MAX_SESSIONS) and the heap never holds stale entries.
+
+// Inserts the slot, or moves it if it is already scheduled.
+void scheduleExpiry(size_t slot, uint32_t expiryTimestamp);
+
+void cancelExpiry(size_t slot);
+
+// Returns false if nothing is scheduled.
+bool peekExpiry(size_t &slot, uint32_t &expiryTimestamp);
+
+void popExpiry();
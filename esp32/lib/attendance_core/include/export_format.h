@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "record_pool.h"
+
+// Columnar export block, one per read of the export characteristic. Each
+// block stands alone and covers the records [offset, offset + count) of one
+// session; record sequence numbers are offset + 1 onwards. Varints are
+// unsigned LEB128, signed deltas are zigzag-encoded first.
+//
+//   u8       format version (EXPORT_FORMAT_VERSION)
+//   u32      session tag: FNV-1a of the session ID, as in the session frames,
+//            so a client can tell a block of another session from its own
+//   varint   offset, varint total records in the session, varint count
+//   u32      timestamp of the first record
+//   count-1  signed varint deltas from the previous record's timestamp
+//   count    matric numbers: u8 bytes shared with the previous matric,
+//            u8 suffix length, suffix
+//   varint   name dictionary size, then each name as u8 length + bytes
+//   count    varint dictionary index of each record's name
+//
+// Against the JSON page this drops the repeated keys, stores a cohort's
+// shared matric prefix once, and shrinks each timestamp to a byte or two.
+#define EXPORT_FORMAT_VERSION 2
+
+// Most records one block carries.
+#define EXPORT_MAX_RECORDS 32
+
+// A block with a count of 0 stops after the count: the cursor is at the end
+// of the session.
+//
+// Encodes as many of records[0..available) as fit in capacity, up to
+// EXPORT_MAX_RECORDS. Sets count to the number encoded and returns the
+// block length, which is 0 if there are records but not even the first
+// fits.
+size_t encodeExportBlock(uint32_t sessionTag, const AttendanceRecord *records, size_t available, size_t offset,
+                         size_t total, uint8_t *out, size_t capacity, size_t &count);
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "wire_format.h"
+
+// Framing for the on-flash attendance journal. Every entry is
+//
+//   u8       type
+//   u8       payload length P
+//   P bytes  payload
+//   u16      low half of the FNV-1a hash of type, length and payload
+//
+// A session entry carries the length-prefixed session ID, course code and
+// course name followed by a u32 expiry. A mark entry carries a v1 binary mark
+// (see wire_format.h). A close entry carries the length-prefixed session ID.
+// Integers are little-endian.
+#define JOURNAL_ENTRY_OVERHEAD 4
+#define JOURNAL_ENTRY_MAX_BYTES (JOURNAL_ENTRY_OVERHEAD + 255)
+
+enum JournalEntryType : uint8_t
+{
+    JOURNAL_SESSION = 1,
+    JOURNAL_MARK = 2,
+    JOURNAL_CLOSE = 3,
+};
+
+struct JournalSession
+{
+    WireString sessionId;
+    WireString courseCode;
+    WireString courseName;
+    uint32_t expiryTimestamp;
+};
+
+// An entry whose check matched. The payload points into the decoded buffer.
+struct JournalEntry
+{
+    JournalEntryType type;
+    const uint8_t *payload;
+    uint8_t length;
+};
+
+// Each returns the encoded length, or 0 if it does not fit in capacity.
+size_t encodeJournalSession(const JournalSession &session, uint8_t *out, size_t capacity);
+size_t encodeJournalMark(const MarkAttendanceMessage &mark, uint8_t *out, size_t capacity);
+size_t encodeJournalClose(WireString sessionId, uint8_t *out, size_t capacity);
+
+// Returns the number of bytes the entry occupies, or 0 if the buffer holds
+// a truncated or corrupt entry; a torn write at the tail shows up as either.
+size_t decodeJournalEntry(const uint8_t *data, size_t length, JournalEntry &out);
+
+bool decodeJournalSession(const JournalEntry &entry, JournalSession &out);
+bool decodeJournalMark(const JournalEntry &entry, MarkAttendanceMessage &out);
+bool decodeJournalClose(const JournalEntry &entry, WireString &sessionId);
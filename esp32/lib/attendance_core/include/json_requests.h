@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "record_pool.h"
+#include "session_store.h"
+#include "wire_format.h"
+#include "write_status.h"
+
+// Decoders for the JSON writes the app sends. Each copies what it needs
+// into fixed fields, so the result does not depend on the input or a
+// JsonDocument staying alive.
+
+struct CreateSessionRequest
+{
+    char sessionId[SESSION_ID_MAX_LEN + 1];
+    size_t sessionIdLength;
+    char courseCode[COURSE_CODE_MAX_LEN + 1];
+    char courseName[COURSE_NAME_MAX_LEN + 1];
+    unsigned long expiryTimestamp;
+};
+
+// {"sessionId", "courseCode", "courseName", "expiryTimestamp"}. Returns
+// MALFORMED if it does not parse and INVALID_FIELD if the session ID is
+// empty or longer than SESSION_ID_MAX_LEN. Course fields are truncated.
+WriteStatus decodeCreateSessionRequest(const char *json, size_t length, CreateSessionRequest &out);
+
+struct MarkRequest
+{
+    // Left empty when the ID is too long to name any session.
+    char sessionId[SESSION_ID_MAX_LEN + 1];
+    char name[RECORD_NAME_MAX_LEN + 1];
+    // One byte over the limit, so an over-long matric number still fails
+    // validation instead of being truncated into someone else's.
+    char matricNumber[RECORD_MATRIC_MAX_LEN + 2];
+    uint32_t timestamp;
+};
+
+// {"sessionId", "studentName" (or "name" from older builds), "matricNumber",
+// "timestamp"}. Returns false if it does not parse.
+bool decodeMarkRequest(const char *json, size_t length, MarkRequest &out);
+
+// View of a decoded request in the shape the binary decoders produce.
+MarkAttendanceMessage markMessage(const MarkRequest &request);
+
+struct PageRequest
+{
+    // Left empty when the ID is too long to name any session.
+    char sessionId[SESSION_ID_MAX_LEN + 1];
+    size_t offset;
+};
+
+// {"sessionId", "cursor"} or {"sessionId", "since"}. Sequence numbers run
+// 1..count in append order, so "since N" starts at offset N. Returns false
+// if it does not parse.
+bool decodePageRequest(const char *json, size_t length, PageRequest &out);
+
+// Either a little-endian u32 of epoch seconds or {"timestamp": N}. Returns
+// false if it is neither; range checks are up to the caller.
+bool decodeTimeSync(const uint8_t *data, size_t length, uint32_t &epochSeconds);
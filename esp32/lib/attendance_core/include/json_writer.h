@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Writes JSON straight into a caller's buffer, with no document tree and no
+// intermediate String. Room for the closing brackets of every open container
+// is always kept back, so a writer that runs out of space can rewind to the
+// last complete element and still close into valid JSON.
+//
+// Once a write does not fit the writer is marked full and ignores further
+// writes until it is rewound. Nesting is limited to JSON_WRITER_MAX_DEPTH.
+#define JSON_WRITER_MAX_DEPTH 8
+
+class JsonWriter
+{
+public:
+    struct Mark
+    {
+        size_t length;
+        uint8_t depth;
+        uint8_t pendingComma;
+    };
+
+    JsonWriter(char *buffer, size_t capacity);
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+
+    void key(const char *name);
+    void value(const char *text);
+    void value(const char *text, size_t length);
+    void value(unsigned long number);
+
+    // Holds back bytes for something the caller will write last.
+    void reserve(size_t bytes);
+    void release(size_t bytes);
+
+    Mark mark() const;
+    void rewind(const Mark &mark);
+
+    bool full() const { return isFull; }
+    size_t length() const { return used; }
+
+private:
+    void open(char bracket);
+    void close(char bracket);
+    void separate();
+    bool fits(size_t bytes) const;
+    void put(char c);
+    void put(const char *data, size_t length);
+
+    char *buffer;
+    size_t capacity;
+    size_t used;
+    size_t reserved;
+    uint8_t depth;
+    // Bit n set: the container at depth n already has an element.
+    uint8_t pendingComma;
+    bool afterKey;
+    bool isFull;
+};
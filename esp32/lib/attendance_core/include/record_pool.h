@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RECORD_NAME_MAX_LEN 39
+#define RECORD_MATRIC_MAX_LEN 16
+
+// Records are handed out in fixed-size chunks from one pool that is sized
+// and allocated once at boot, so nothing is allocated while marking and a
+// session's records can be returned to the pool in O(1) by splicing its
+// chunk list.
+#define RECORD_CHUNK_SIZE 16
+// Handles and dedup entries (handle + 1) are 16-bit.
+#define RECORD_POOL_MAX_CAPACITY (0xFFFF / RECORD_CHUNK_SIZE * RECORD_CHUNK_SIZE)
+#ifndef MAX_RECORDS_PER_SESSION
+#define MAX_RECORDS_PER_SESSION 512
+#endif
+
+#define NO_CHUNK 0xFFFF
+
+struct AttendanceRecord
+{
+    char name[RECORD_NAME_MAX_LEN + 1];
+    char matricNumber[RECORD_MATRIC_MAX_LEN + 1];
+    // Per-session, starting at 1 and increasing in append order.
+    uint16_t sequence;
+    uint32_t timestamp;
+};
+
+// Chain of pool chunks owned by one session.
+struct RecordList
+{
+    uint16_t head;
+    uint16_t tail;
+    uint16_t count;
+};
+
+// Sequential read position within a RecordList.
+struct RecordCursor
+{
+    uint16_t chunk;
+    size_t index;
+};
+
+extern AttendanceRecord *recordPool;
+
+// Bytes one chunk needs: its records plus its link.
+#define RECORD_CHUNK_BYTES (RECORD_CHUNK_SIZE * sizeof(AttendanceRecord) + sizeof(uint16_t))
+
+// Takes over caller-provided storage for capacity records and one link per
+// chunk. capacity is rounded down to whole chunks and clamped to
+// RECORD_POOL_MAX_CAPACITY; the capacity in use is returned.
+size_t initRecordPool(AttendanceRecord *records, uint16_t *chunkLinks, size_t capacity);
+
+size_t recordPoolCapacity();
+
+void initRecordList(RecordList &list);
+
+// Returns a zeroed record at the end of the list, or nullptr if the session
+// is at MAX_RECORDS_PER_SESSION or the pool has no free chunk left.
+AttendanceRecord *appendRecord(RecordList &list);
+
+// Gives every chunk of the list back to the pool in O(1).
+void releaseRecords(RecordList &list);
+
+RecordCursor recordCursorAt(const RecordList &list, size_t index);
+
+// Returns the record under the cursor and advances it, or nullptr at the end.
+const AttendanceRecord *nextRecord(const RecordList &list, RecordCursor &cursor);
+
+size_t freeRecordCapacity();
+
+// Stable index of a record in recordPool.
+inline uint16_t recordHandle(const AttendanceRecord *record)
+{
+    return static_cast<uint16_t>(record - recordPool);
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dedup_index.h"
+#include "record_pool.h"
+#include "store_capacity.h"
+
+#define SESSION_ID_MAX_LEN 95
+#define COURSE_CODE_MAX_LEN 15
+#define COURSE_NAME_MAX_LEN 63
+
+struct AttendanceSession
+{
+    char courseCode[COURSE_CODE_MAX_LEN + 1];
+    char courseName[COURSE_NAME_MAX_LEN + 1];
+    unsigned long expiryTimestamp;
+};
+
+// One slot per session, allocated with the rest of the store at boot. The
+// session ID is stored inline next to its FNV-1a hash so a lookup is a scan
+// over sessionCapacity hashes with a single memcmp on a hit.
+struct SessionSlot
+{
+    bool inUse;
+    uint32_t idHash;
+    uint8_t idLength;
+    char sessionId[SESSION_ID_MAX_LEN + 1];
+    AttendanceSession session;
+    RecordList attendances;
+    DedupIndex marked;
+};
+
+extern SessionSlot *sessionTable;
+extern size_t sessionCapacity;
+
+// Takes over caller-provided, zeroed storage for capacity slots.
+void initSessionTable(SessionSlot *slots, size_t capacity);
+
+// Range over every slot, in use or not, for range-based for loops.
+struct SessionSlots
+{
+    SessionSlot *first;
+    size_t count;
+
+    SessionSlot *begin() const { return first; }
+    SessionSlot *end() const { return first + count; }
+};
+
+inline SessionSlots sessionSlots()
+{
+    return {sessionTable, sessionCapacity};
+}
+
+// Bumped whenever a session is added, removed or has its metadata changed,
+// so serialized views of the table know when to regenerate. Written under
+// StoreLock; readers may load it without the lock to decide whether they
+// need it at all.
+extern std::atomic<uint32_t> sessionTableGeneration;
+
+inline size_t sessionIndex(const SessionSlot *slot)
+{
+    return static_cast<size_t>(slot - sessionTable);
+}
+
+SessionSlot *findSession(const char *id, size_t length);
+
+// Returns the slot already holding this ID, or claims a free one. Returns
+// nullptr if the ID is too long or every slot is taken; a full table is the
+// admission limit for new sessions.
+SessionSlot *claimSession(const char *id, size_t length);
+
+void releaseSession(SessionSlot *slot);
+
+// Call after changing a claimed slot's metadata.
+inline void touchSessionTable()
+{
+    sessionTableGeneration.fetch_add(1, std::memory_order_release);
+}
+
+size_t activeSessionCount();
+
+enum AddAttendanceResult
+{
+    ATTENDANCE_ADDED,
+    ATTENDANCE_DUPLICATE,
+    ATTENDANCE_NO_STORAGE,
+};
+
+// Appends a record unless the matric number is already in the session. The
+// matric number must be 1..RECORD_MATRIC_MAX_LEN characters. On
+// ATTENDANCE_ADDED, record points at the new entry.
+AddAttendanceResult addAttendance(SessionSlot &slot, const char *name, size_t nameLength,
+                                  const char *matric, size_t matricLength, uint32_t timestamp,
+                                  AttendanceRecord *&record);
+
+// Copies src into a fixed-size field, truncating to capacity - 1 characters.
+void copyField(char *dest, size_t capacity, const char *src, size_t length);
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hash.h"
+
+// Frames exchanged between the beacons of one sharded hall over ESP-NOW.
+// Each beacon numbers the journal entries it originates and broadcasts them;
+// peers apply each stream in order and ask for a replay when they see a gap.
+//
+//   u8       version (SHARD_FRAME_VERSION)
+//   u8       frame type
+//   u8       sender's shard ID
+//   u32      sender's incarnation, random per boot
+//   u32      sequence: of this entry, the latest entry sent (heartbeat) or
+//            the first one wanted (resend)
+//   then by type:
+//     entry      a journal entry (journal_format.h), the rest of the frame
+//     heartbeat  u32 oldest sequence the sender can still replay
+//     resend     u8 shard and u32 incarnation whose stream to replay
+//   8 bytes  first bytes of HMAC-SHA256 over everything before it, keyed
+//            with the hall's mesh key
+//
+// Integers are little-endian. Sequences start at 1.
+#define SHARD_FRAME_VERSION 1
+// ESP-NOW's payload limit.
+#define SHARD_FRAME_MAX_BYTES 250
+#define SHARD_MAC_BYTES 8
+#define SHARD_HEADER_BYTES (1 + 1 + 1 + 4 + 4)
+#define SHARD_ENTRY_MAX_BYTES (SHARD_FRAME_MAX_BYTES - SHARD_HEADER_BYTES - SHARD_MAC_BYTES)
+#define SHARD_MAX_COUNT 8
+
+enum ShardFrameType : uint8_t
+{
+    SHARD_FRAME_ENTRY = 1,
+    SHARD_FRAME_HEARTBEAT = 2,
+    SHARD_FRAME_RESEND = 3,
+};
+
+struct ShardFrame
+{
+    ShardFrameType type;
+    uint8_t shardId;
+    uint32_t incarnation;
+    uint32_t sequence;
+    // Entry frames. Points into the decoded buffer.
+    const uint8_t *entry;
+    size_t entryLength;
+    // Heartbeat frames.
+    uint32_t oldestSequence;
+    // Resend frames.
+    uint8_t targetShard;
+    uint32_t targetIncarnation;
+};
+
+// Encodes everything but the MAC and returns its length n; the caller
+// signs out[0..n) and appends SHARD_MAC_BYTES at out + n. Returns 0 if n
+// plus the MAC does not fit in capacity.
+size_t encodeShardFrame(const ShardFrame &frame, uint8_t *out, size_t capacity);
+
+// Returns false unless the frame is well formed for its type and names a
+// shard below SHARD_MAX_COUNT. Sets signedLength to the bytes the MAC
+// covers; the MAC itself follows them.
+bool decodeShardFrame(const uint8_t *data, size_t length, ShardFrame &out, size_t &signedLength);
+
+// The shard a student's phone should mark with, so a hall's students spread
+// evenly across its beacons. The app computes the same.
+inline uint8_t shardForMatric(const char *matric, size_t length, uint8_t shardCount)
+{
+    return shardCount <= 1 ? 0 : static_cast<uint8_t>(fnv1a(matric, length) % shardCount);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+
+// Session slots and attendance records are sized at boot from a RAM budget
+// instead of fixed counts. The budget is further limited to what the heap
+// can spare after STORE_HEAP_RESERVE_BYTES is set aside for NimBLE, the
+// filesystem and task stacks.
+#ifndef STORE_RAM_BUDGET_BYTES
+#define STORE_RAM_BUDGET_BYTES (96UL * 1024UL)
+#endif
+#ifndef STORE_HEAP_RESERVE_BYTES
+#define STORE_HEAP_RESERVE_BYTES (64UL * 1024UL)
+#endif
+
+// With STORE_RECORDS_IN_PSRAM the record array moves to external PSRAM
+// under its own budget. Session slots, their dedup indexes and the chunk
+// links stay in internal SRAM, because they are read on every mark.
+#ifndef STORE_PSRAM_BUDGET_BYTES
+#define STORE_PSRAM_BUDGET_BYTES (2UL * 1024UL * 1024UL)
+#endif
+
+// Compile-time ceiling on sessions; the expiry heap is sized by it.
+#ifndef STORE_MAX_SESSIONS
+#define STORE_MAX_SESSIONS 16
+#endif
+static_assert(STORE_MAX_SESSIONS > 0 && STORE_MAX_SESSIONS < 256, "STORE_MAX_SESSIONS must fit the expiry heap's 8-bit slots");
+
+// Expected records per session, used to split the budget between slots and
+// records. Sessions can still grow up to MAX_RECORDS_PER_SESSION while the
+// shared pool lasts.
+#ifndef STORE_RECORDS_PER_SESSION
+#define STORE_RECORDS_PER_SESSION 96
+#endif
+
+struct StoreCapacity
+{
+    size_t sessions;
+    size_t records;
+    // Internal and external RAM the plan takes.
+    size_t bytes;
+    size_t externalBytes;
+};
+
+// Splits budgetBytes into at most STORE_MAX_SESSIONS slots of sessionBytes
+// and whole record chunks of chunkBytes each. Returns zero sessions if
+// the budget cannot hold one session with one chunk.
+StoreCapacity planStoreCapacity(size_t budgetBytes, size_t sessionBytes, size_t chunkBytes);
+
+// As planStoreCapacity, with records of recordBytes drawn from
+// externalBudgetBytes. Only slots and one 16-bit link per chunk count
+// against internalBudgetBytes.
+StoreCapacity planTieredStoreCapacity(size_t internalBudgetBytes, size_t externalBudgetBytes,
+                                      size_t sessionBytes, size_t recordBytes);
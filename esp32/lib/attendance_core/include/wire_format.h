@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Fixed-layout binary encoding for mark-attendance writes. All integers are
+// little-endian.
+//
+//   u8       version (WIRE_FORMAT_VERSION)
+//   u8       session ID length S
+//   S bytes  session ID
+//   u8       name length N
+//   N bytes  name
+//   16 bytes matric number, ASCII, NUL-padded
+//   u32      timestamp (epoch seconds)
+//
+// Attendance delta notifications carry a u32 stream sequence number followed
+// by the same record layout.
+//
+// Batched marks share one session ID:
+//
+//   u8       version (WIRE_FORMAT_VERSION)
+//   u8       session ID length S
+//   S bytes  session ID
+//   u8       record count R (1..WIRE_BATCH_MAX_RECORDS)
+//   R times:
+//     u8       name length N
+//     N bytes  name
+//     16 bytes matric number, ASCII, NUL-padded
+//     u32      timestamp (epoch seconds)
+//
+// Its status readback is u8 R followed by a bitmap of R bits, LSB first, with
+// a set bit for each record that is on the session's list.
+#define WIRE_FORMAT_VERSION 1
+#define WIRE_MATRIC_BYTES 16
+#define WIRE_MARK_MAX_BYTES (1 + 1 + 255 + 1 + 255 + WIRE_MATRIC_BYTES + 4)
+#define WIRE_BATCH_MAX_RECORDS 32
+#define WIRE_BATCH_STATUS_BYTES (1 + (WIRE_BATCH_MAX_RECORDS + 7) / 8)
+
+struct WireString
+{
+    const char *data;
+    uint8_t length;
+};
+
+// Decoded view of a mark-attendance write. The strings point into the
+// buffer that was decoded and are not NUL-terminated.
+struct MarkAttendanceMessage
+{
+    WireString sessionId;
+    WireString name;
+    WireString matricNumber;
+    uint32_t timestamp;
+};
+
+// Wraps a NUL-terminated string, clamping it to what the wire format can
+// carry.
+inline WireString makeWireString(const char *value)
+{
+    size_t length = strlen(value);
+    return {value, static_cast<uint8_t>(length < 255 ? length : 255)};
+}
+
+// Returns false if the buffer is truncated, has trailing bytes or carries an
+// unsupported version.
+bool decodeMarkAttendance(const uint8_t *data, size_t length, MarkAttendanceMessage &out);
+
+// Returns the encoded length, or 0 if it does not fit in capacity.
+size_t encodeMarkAttendance(const MarkAttendanceMessage &message, uint8_t *out, size_t capacity);
+
+// Encodes a delta notification: sequence, then the record.
+size_t encodeAttendanceDelta(uint32_t sequence, const MarkAttendanceMessage &message, uint8_t *out, size_t capacity);
+
+// Validated view of a batch write. Records are walked with nextBatchRecord.
+struct MarkBatch
+{
+    WireString sessionId;
+    uint8_t count;
+    const uint8_t *records;
+    size_t recordsLength;
+};
+
+// Returns false if any record is truncated, the count is out of range or
+// there are trailing bytes.
+bool decodeMarkBatch(const uint8_t *data, size_t length, MarkBatch &out);
+
+// Decodes the record at pos and advances it. Only valid on a batch that
+// decodeMarkBatch accepted; returns false past the last record.
+bool nextBatchRecord(const MarkBatch &batch, size_t &pos, MarkAttendanceMessage &out);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+// Outcome of a write, reported on the status characteristic as two bytes:
+// u8 operation, u8 status. Clients stop retrying on an accepted or rejected
+// status and back off on a transient one.
+enum WriteOperation : uint8_t
+{
+    WRITE_OP_CREATE_SESSION = 1,
+    WRITE_OP_MARK = 2,
+    WRITE_OP_MARK_BATCH = 3,
+    WRITE_OP_TIME_SYNC = 4,
+    WRITE_OP_PAGE_REQUEST = 5,
+};
+
+enum WriteStatus : uint8_t
+{
+    // Accepted.
+    WRITE_STATUS_OK = 0,
+    WRITE_STATUS_DUPLICATE = 1,
+    // Rejected; the same write will never succeed.
+    WRITE_STATUS_MALFORMED = 16,
+    WRITE_STATUS_INVALID_FIELD = 17,
+    WRITE_STATUS_UNKNOWN_SESSION = 18,
+    WRITE_STATUS_EXPIRED = 19,
+    // Transient; retry later.
+    WRITE_STATUS_RATE_LIMITED = 32,
+    WRITE_STATUS_SESSIONS_FULL = 33,
+    WRITE_STATUS_STORAGE_FULL = 34,
+    // The session table is still being restored from flash after a reset.
+    WRITE_STATUS_RESTORING = 35,
+};
+
+#define WRITE_STATUS_BYTES 2
+
+inline bool isWriteAccepted(WriteStatus status)
+{
+    return status == WRITE_STATUS_OK || status == WRITE_STATUS_DUPLICATE;
+}
@@ -0,0 +1,79 @@
+#include "beacon_frames.h"
+
+#include <string.h>
+
+#define SESSION_FRAME_HEADER_BYTES (2 + 1 + 1 + 1 + 1 + 4 + 2)
+#define MARK_FRAME_FIXED_BYTES (2 + 1 + 4 + 4 + BEACON_MAC_BYTES)
+
+static void writeUint16(uint8_t *out, uint16_t value)
+{
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+static void writeUint32(uint8_t *out, uint32_t value)
+{
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+    out[2] = static_cast<uint8_t>(value >> 16);
+    out[3] = static_cast<uint8_t>(value >> 24);
+}
+
+static uint32_t readUint32(const uint8_t *data)
+{
+    return static_cast<uint32_t>(data[0]) |
+           (static_cast<uint32_t>(data[1]) << 8) |
+           (static_cast<uint32_t>(data[2]) << 16) |
+           (static_cast<uint32_t>(data[3]) << 24);
+}
+
+size_t encodeSessionFrame(const SessionFrame &frame, uint8_t *out, size_t capacity)
+{
+    if (capacity > BEACON_MANUFACTURER_MAX)
+    {
+        capacity = BEACON_MANUFACTURER_MAX;
+    }
+    if (capacity < SESSION_FRAME_HEADER_BYTES)
+    {
+        return 0;
+    }
+
+    size_t pos = 0;
+    writeUint16(out + pos, BEACON_COMPANY_ID);
+    pos += 2;
+    out[pos++] = BEACON_FRAME_SESSION;
+    out[pos++] = frame.generation;
+    out[pos++] = frame.index;
+    out[pos++] = frame.count;
+    writeUint32(out + pos, frame.sessionTag);
+    pos += 4;
+    writeUint16(out + pos, frame.minutesToExpiry);
+    pos += 2;
+
+    size_t room = capacity - pos;
+    size_t codeLength = frame.courseCode.length < room ? frame.courseCode.length : room;
+    memcpy(out + pos, frame.courseCode.data, codeLength);
+    return pos + codeLength;
+}
+
+bool decodeMarkFrame(const uint8_t *data, size_t length, MarkFrame &out)
+{
+    if (length <= MARK_FRAME_FIXED_BYTES || length - MARK_FRAME_FIXED_BYTES > BEACON_MARK_MATRIC_MAX)
+    {
+        return false;
+    }
+    uint16_t company = static_cast<uint16_t>(data[0] | (data[1] << 8));
+    if (company != BEACON_COMPANY_ID || data[2] != BEACON_FRAME_MARK)
+    {
+        return false;
+    }
+
+    out.sessionTag = readUint32(data + 3);
+    out.timestamp = readUint32(data + 7);
+    out.matricNumber.data = reinterpret_cast<const char *>(data + 11);
+    out.matricNumber.length = static_cast<uint8_t>(length - MARK_FRAME_FIXED_BYTES);
+    out.signedData = data + 2;
+    out.signedLength = length - 2 - BEACON_MAC_BYTES;
+    out.mac = data + length - BEACON_MAC_BYTES;
+    return true;
+}
@@ -0,0 +1,30 @@
+#include "dedup_index.h"
+
+#include <string.h>
+
+#include "hash.h"
+
+void clearDedupIndex(DedupIndex &index)
+{
+    memset(index.slots, 0, sizeof(index.slots));
+}
+
+uint16_t *findDedupEntry(DedupIndex &index, const char *matricNumber, size_t length)
+{
+    size_t position = fnv1a(matricNumber, length) & (DEDUP_INDEX_SLOTS - 1);
+    while (true)
+    {
+        uint16_t *entry = &index.slots[position];
+        if (*entry == 0)
+        {
+            return entry;
+        }
+
+        const AttendanceRecord &record = recordPool[*entry - 1];
+        if (strncmp(record.matricNumber, matricNumber, length) == 0 && record.matricNumber[length] == '\0')
+        {
+            return entry;
+        }
+        position = (position + 1) & (DEDUP_INDEX_SLOTS - 1);
+    }
+}
@@ -0,0 +1,46 @@
+#include "epoch_clock.h"
+
+void resetEpochClock(EpochClock &clock)
+{
+    clock.anchored = false;
+    clock.synced = false;
+    clock.offsetMillis = 0;
+    clock.floorMillis = 0;
+}
+
+void syncEpochClock(EpochClock &clock, uint32_t epochSeconds, uint64_t nowMillis)
+{
+    clock.offsetMillis = static_cast<int64_t>(epochSeconds) * 1000 - static_cast<int64_t>(nowMillis);
+    // The phone is authoritative, so a clock anchored ahead of it comes back.
+    clock.floorMillis = 0;
+    clock.anchored = true;
+    clock.synced = true;
+}
+
+bool observeEpochClock(EpochClock &clock, uint32_t epochSeconds, uint64_t nowMillis)
+{
+    if (clock.anchored)
+    {
+        return false;
+    }
+    clock.offsetMillis = static_cast<int64_t>(epochSeconds) * 1000 - static_cast<int64_t>(nowMillis);
+    clock.anchored = true;
+    return true;
+}
+
+bool readEpochClock(EpochClock &clock, uint64_t nowMillis, uint32_t &epochSeconds)
+{
+    if (!clock.anchored)
+    {
+        epochSeconds = 0;
+        return false;
+    }
+    int64_t epochMillis = static_cast<int64_t>(nowMillis) + clock.offsetMillis;
+    if (epochMillis < clock.floorMillis)
+    {
+        epochMillis = clock.floorMillis;
+    }
+    clock.floorMillis = epochMillis;
+    epochSeconds = static_cast<uint32_t>(epochMillis / 1000);
+    return true;
+}
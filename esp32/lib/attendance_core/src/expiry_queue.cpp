@@ -0,0 +1,124 @@
+#include "expiry_queue.h"
+
+struct ExpiryEntry
+{
+    uint32_t expiryTimestamp;
+    uint8_t slot;
+};
+
+static ExpiryEntry heap[STORE_MAX_SESSIONS];
+static size_t heapSize = 0;
+// Heap position + 1 of each slot; zero means not scheduled.
+static uint8_t heapPosition[STORE_MAX_SESSIONS];
+
+static void place(size_t position, const ExpiryEntry &entry)
+{
+    heap[position] = entry;
+    heapPosition[entry.slot] = static_cast<uint8_t>(position + 1);
+}
+
+static void siftUp(size_t position)
+{
+    ExpiryEntry entry = heap[position];
+    while (position > 0)
+    {
+        size_t parent = (position - 1) / 2;
+        if (heap[parent].expiryTimestamp <= entry.expiryTimestamp)
+        {
+            break;
+        }
+        place(position, heap[parent]);
+        position = parent;
+    }
+    place(position, entry);
+}
+
+static void siftDown(size_t position)
+{
+    ExpiryEntry entry = heap[position];
+    while (true)
+    {
+        size_t child = 2 * position + 1;
+        if (child >= heapSize)
+        {
+            break;
+        }
+        if (child + 1 < heapSize && heap[child + 1].expiryTimestamp < heap[child].expiryTimestamp)
+        {
+            ++child;
+        }
+        if (entry.expiryTimestamp <= heap[child].expiryTimestamp)
+        {
+            break;
+        }
+        place(position, heap[child]);
+        position = child;
+    }
+    place(position, entry);
+}
+
+static void restore(size_t position)
+{
+    if (position > 0 && heap[position].expiryTimestamp < heap[(position - 1) / 2].expiryTimestamp)
+    {
+        siftUp(position);
+    }
+    else
+    {
+        siftDown(position);
+    }
+}
+
+static void removeAt(size_t position)
+{
+    heapPosition[heap[position].slot] = 0;
+    --heapSize;
+    if (position == heapSize)
+    {
+        return;
+    }
+    place(position, heap[heapSize]);
+    restore(position);
+}
+
+void scheduleExpiry(size_t slot, uint32_t expiryTimestamp)
+{
+    if (heapPosition[slot] != 0)
+    {
+        size_t position = heapPosition[slot] - 1;
+        heap[position].expiryTimestamp = expiryTimestamp;
+        restore(position);
+        return;
+    }
+
+    place(heapSize, {expiryTimestamp, static_cast<uint8_t>(slot)});
+    ++heapSize;
+    siftUp(heapSize - 1);
+}
+
+void cancelExpiry(size_t slot)
+{
+    if (heapPosition[slot] != 0)
+    {
+        removeAt(heapPosition[slot] - 1);
+    }
+}
+
+bool peekExpiry(size_t &slot, uint32_t &expiryTimestamp)
+{
+    if (heapSize == 0)
+    {
+        return false;
+    }
+    slot = heap[0].slot;
+    expiryTimestamp = heap[0].expiryTimestamp;
+    return true;
+}
+
+void popExpiry()
+{
+    if (heapSize > 0)
+    {
+        removeAt(0);
+    }
+}
@@ -0,0 +1,151 @@
+#include "export_format.h"
+
+#include <string.h>
+
+static size_t varintSize(uint64_t value)
+{
+    size_t size = 1;
+    while (value >= 0x80)
+    {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+static size_t writeVarint(uint8_t *out, uint64_t value)
+{
+    size_t pos = 0;
+    while (value >= 0x80)
+    {
+        out[pos++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    out[pos++] = static_cast<uint8_t>(value);
+    return pos;
+}
+
+static size_t writeUint32(uint8_t *out, uint32_t value)
+{
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+    out[2] = static_cast<uint8_t>(value >> 16);
+    out[3] = static_cast<uint8_t>(value >> 24);
+    return 4;
+}
+
+static uint64_t timestampDelta(uint32_t previous, uint32_t current)
+{
+    int64_t delta = static_cast<int64_t>(current) - static_cast<int64_t>(previous);
+    return (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+}
+
+static size_t sharedPrefix(const char *a, const char *b)
+{
+    size_t length = 0;
+    while (a[length] != '\0' && a[length] == b[length])
+    {
+        ++length;
+    }
+    return length;
+}
+
+size_t encodeExportBlock(uint32_t sessionTag, const AttendanceRecord *records, size_t available, size_t offset,
+                         size_t total, uint8_t *out, size_t capacity, size_t &count)
+{
+    if (available > EXPORT_MAX_RECORDS)
+    {
+        available = EXPORT_MAX_RECORDS;
+    }
+    size_t headerLength = 1 + 4 + varintSize(offset) + varintSize(total) + 1;
+    if (capacity < headerLength)
+    {
+        count = 0;
+        return 0;
+    }
+
+    // Plan: take records while the block still fits. Counts and dictionary
+    // indexes stay below 128, so each costs a single varint byte.
+    uint8_t nameIndex[EXPORT_MAX_RECORDS];
+    uint8_t dictionary[EXPORT_MAX_RECORDS];
+    size_t dictionarySize = 0;
+    size_t length = headerLength + 4 + 1;
+    count = 0;
+    for (size_t i = 0; i < available; ++i)
+    {
+        const AttendanceRecord &record = records[i];
+        size_t cost = 0;
+        if (i > 0)
+        {
+            cost += varintSize(timestampDelta(records[i - 1].timestamp, record.timestamp));
+        }
+        size_t shared = i > 0 ? sharedPrefix(records[i - 1].matricNumber, record.matricNumber) : 0;
+        cost += 2 + strlen(record.matricNumber) - shared;
+
+        size_t entry = 0;
+        while (entry < dictionarySize && strcmp(records[dictionary[entry]].name, record.name) != 0)
+        {
+            ++entry;
+        }
+        cost += 1 + (entry == dictionarySize ? 1 + strlen(record.name) : 0);
+
+        if (length + cost > capacity)
+        {
+            break;
+        }
+        if (entry == dictionarySize)
+        {
+            dictionary[dictionarySize++] = static_cast<uint8_t>(i);
+        }
+        nameIndex[i] = static_cast<uint8_t>(entry);
+        length += cost;
+        ++count;
+    }
+    if (count == 0 && available > 0)
+    {
+        return 0;
+    }
+
+    size_t pos = 0;
+    out[pos++] = EXPORT_FORMAT_VERSION;
+    pos += writeUint32(out + pos, sessionTag);
+    pos += writeVarint(out + pos, offset);
+    pos += writeVarint(out + pos, total);
+    pos += writeVarint(out + pos, count);
+    if (count == 0)
+    {
+        return pos;
+    }
+
+    pos += writeUint32(out + pos, records[0].timestamp);
+    for (size_t i = 1; i < count; ++i)
+    {
+        pos += writeVarint(out + pos, timestampDelta(records[i - 1].timestamp, records[i].timestamp));
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const char *matric = records[i].matricNumber;
+        size_t shared = i > 0 ? sharedPrefix(records[i - 1].matricNumber, matric) : 0;
+        size_t suffix = strlen(matric) - shared;
+        out[pos++] = static_cast<uint8_t>(shared);
+        out[pos++] = static_cast<uint8_t>(suffix);
+        memcpy(out + pos, matric + shared, suffix);
+        pos += suffix;
+    }
+
+    pos += writeVarint(out + pos, dictionarySize);
+    for (size_t entry = 0; entry < dictionarySize; ++entry)
+    {
+        const char *name = records[dictionary[entry]].name;
+        size_t nameLength = strlen(name);
+        out[pos++] = static_cast<uint8_t>(nameLength);
+        memcpy(out + pos, name, nameLength);
+        pos += nameLength;
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[pos++] = nameIndex[i];
+    }
+    return pos;
+}
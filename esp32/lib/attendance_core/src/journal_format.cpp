@@ -0,0 +1,149 @@
+#include "journal_format.h"
+
+#include <string.h>
+
+#include "hash.h"
+
+static uint16_t entryCheck(const uint8_t *entry, size_t payloadLength)
+{
+    return static_cast<uint16_t>(fnv1a(reinterpret_cast<const char *>(entry), 2 + payloadLength));
+}
+
+// Wraps a payload already written at out + 2 in its header and check.
+static size_t frameEntry(JournalEntryType type, size_t payloadLength, uint8_t *out, size_t capacity)
+{
+    if (payloadLength == 0 || payloadLength > 255 || payloadLength + JOURNAL_ENTRY_OVERHEAD > capacity)
+    {
+        return 0;
+    }
+    out[0] = type;
+    out[1] = static_cast<uint8_t>(payloadLength);
+    uint16_t check = entryCheck(out, payloadLength);
+    out[2 + payloadLength] = static_cast<uint8_t>(check);
+    out[3 + payloadLength] = static_cast<uint8_t>(check >> 8);
+    return payloadLength + JOURNAL_ENTRY_OVERHEAD;
+}
+
+static size_t writeString(WireString value, uint8_t *out, size_t pos, size_t capacity)
+{
+    if (pos + 1 + value.length > capacity)
+    {
+        return 0;
+    }
+    out[pos++] = value.length;
+    memcpy(out + pos, value.data, value.length);
+    return pos + value.length;
+}
+
+static bool readString(const uint8_t *data, size_t length, size_t &pos, WireString &out)
+{
+    if (pos >= length || length - pos - 1 < data[pos])
+    {
+        return false;
+    }
+    out.length = data[pos++];
+    out.data = reinterpret_cast<const char *>(data + pos);
+    pos += out.length;
+    return true;
+}
+
+size_t encodeJournalSession(const JournalSession &session, uint8_t *out, size_t capacity)
+{
+    if (capacity < JOURNAL_ENTRY_OVERHEAD)
+    {
+        return 0;
+    }
+    uint8_t *payload = out + 2;
+    size_t payloadCapacity = capacity - JOURNAL_ENTRY_OVERHEAD;
+
+    size_t pos = 0;
+    if ((pos = writeString(session.sessionId, payload, pos, payloadCapacity)) == 0 ||
+        (pos = writeString(session.courseCode, payload, pos, payloadCapacity)) == 0 ||
+        (pos = writeString(session.courseName, payload, pos, payloadCapacity)) == 0 ||
+        pos + sizeof(uint32_t) > payloadCapacity)
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(uint32_t); ++i)
+    {
+        payload[pos++] = static_cast<uint8_t>(session.expiryTimestamp >> (8 * i));
+    }
+    return frameEntry(JOURNAL_SESSION, pos, out, capacity);
+}
+
+size_t encodeJournalMark(const MarkAttendanceMessage &mark, uint8_t *out, size_t capacity)
+{
+    if (capacity < JOURNAL_ENTRY_OVERHEAD)
+    {
+        return 0;
+    }
+    size_t payloadLength = encodeMarkAttendance(mark, out + 2, capacity - JOURNAL_ENTRY_OVERHEAD);
+    return payloadLength == 0 ? 0 : frameEntry(JOURNAL_MARK, payloadLength, out, capacity);
+}
+
+size_t encodeJournalClose(WireString sessionId, uint8_t *out, size_t capacity)
+{
+    if (capacity < JOURNAL_ENTRY_OVERHEAD)
+    {
+        return 0;
+    }
+    size_t payloadLength = writeString(sessionId, out + 2, 0, capacity - JOURNAL_ENTRY_OVERHEAD);
+    return payloadLength == 0 ? 0 : frameEntry(JOURNAL_CLOSE, payloadLength, out, capacity);
+}
+
+size_t decodeJournalEntry(const uint8_t *data, size_t length, JournalEntry &out)
+{
+    if (length < JOURNAL_ENTRY_OVERHEAD)
+    {
+        return 0;
+    }
+    size_t payloadLength = data[1];
+    size_t entryLength = payloadLength + JOURNAL_ENTRY_OVERHEAD;
+    if (length < entryLength)
+    {
+        return 0;
+    }
+
+    uint16_t check = static_cast<uint16_t>(data[2 + payloadLength] | (data[3 + payloadLength] << 8));
+    if (check != entryCheck(data, payloadLength))
+    {
+        return 0;
+    }
+
+    out.type = static_cast<JournalEntryType>(data[0]);
+    out.payload = data + 2;
+    out.length = static_cast<uint8_t>(payloadLength);
+    return entryLength;
+}
+
+bool decodeJournalSession(const JournalEntry &entry, JournalSession &out)
+{
+    size_t pos = 0;
+    if (entry.type != JOURNAL_SESSION ||
+        !readString(entry.payload, entry.length, pos, out.sessionId) ||
+        !readString(entry.payload, entry.length, pos, out.courseCode) ||
+        !readString(entry.payload, entry.length, pos, out.courseName) ||
+        entry.length - pos != sizeof(uint32_t))
+    {
+        return false;
+    }
+    const uint8_t *expiry = entry.payload + pos;
+    out.expiryTimestamp = static_cast<uint32_t>(expiry[0]) |
+                          (static_cast<uint32_t>(expiry[1]) << 8) |
+                          (static_cast<uint32_t>(expiry[2]) << 16) |
+                          (static_cast<uint32_t>(expiry[3]) << 24);
+    return true;
+}
+
+bool decodeJournalMark(const JournalEntry &entry, MarkAttendanceMessage &out)
+{
+    return entry.type == JOURNAL_MARK && decodeMarkAttendance(entry.payload, entry.length, out);
+}
+
+bool decodeJournalClose(const JournalEntry &entry, WireString &sessionId)
+{
+    size_t pos = 0;
+    return entry.type == JOURNAL_CLOSE &&
+           readString(entry.payload, entry.length, pos, sessionId) &&
+           pos == entry.length;
+}
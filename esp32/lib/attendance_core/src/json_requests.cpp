@@ -0,0 +1,101 @@
+#include "json_requests.h"
+
+#include <ArduinoJson.h>
+#include <string.h>
+
+// Copies a string field, or leaves it empty if it would not fit whole.
+static void copyWholeField(char *dest, size_t capacity, const char *src)
+{
+    size_t length = strlen(src);
+    copyField(dest, capacity, src, length < capacity ? length : 0);
+}
+
+static void copyTruncatedField(char *dest, size_t capacity, const char *src)
+{
+    copyField(dest, capacity, src, strlen(src));
+}
+
+WriteStatus decodeCreateSessionRequest(const char *json, size_t length, CreateSessionRequest &out)
+{
+    JsonDocument doc;
+    if (deserializeJson(doc, json, length))
+    {
+        return WRITE_STATUS_MALFORMED;
+    }
+
+    const char *sessionId = doc["sessionId"] | "";
+    out.sessionIdLength = strlen(sessionId);
+    if (out.sessionIdLength == 0 || out.sessionIdLength > SESSION_ID_MAX_LEN)
+    {
+        return WRITE_STATUS_INVALID_FIELD;
+    }
+    copyField(out.sessionId, sizeof(out.sessionId), sessionId, out.sessionIdLength);
+    copyTruncatedField(out.courseCode, sizeof(out.courseCode), doc["courseCode"] | "");
+    copyTruncatedField(out.courseName, sizeof(out.courseName), doc["courseName"] | "");
+    out.expiryTimestamp = doc["expiryTimestamp"].as<unsigned long>();
+    return WRITE_STATUS_OK;
+}
+
+bool decodeMarkRequest(const char *json, size_t length, MarkRequest &out)
+{
+    JsonDocument doc;
+    if (deserializeJson(doc, json, length))
+    {
+        return false;
+    }
+
+    JsonVariant name = doc["studentName"];
+    if (name.isNull())
+    {
+        name = doc["name"];
+    }
+
+    copyWholeField(out.sessionId, sizeof(out.sessionId), doc["sessionId"] | "");
+    copyTruncatedField(out.name, sizeof(out.name), name | "");
+    copyTruncatedField(out.matricNumber, sizeof(out.matricNumber), doc["matricNumber"] | "");
+    out.timestamp = doc["timestamp"].as<unsigned long>();
+    return true;
+}
+
+MarkAttendanceMessage markMessage(const MarkRequest &request)
+{
+    MarkAttendanceMessage message;
+    message.sessionId = makeWireString(request.sessionId);
+    message.name = makeWireString(request.name);
+    message.matricNumber = makeWireString(request.matricNumber);
+    message.timestamp = request.timestamp;
+    return message;
+}
+
+bool decodePageRequest(const char *json, size_t length, PageRequest &out)
+{
+    JsonDocument doc;
+    if (deserializeJson(doc, json, length))
+    {
+        return false;
+    }
+
+    copyWholeField(out.sessionId, sizeof(out.sessionId), doc["sessionId"] | "");
+    out.offset = doc["since"].isNull() ? (doc["cursor"] | 0) : (doc["since"] | 0);
+    return true;
+}
+
+bool decodeTimeSync(const uint8_t *data, size_t length, uint32_t &epochSeconds)
+{
+    if (length == sizeof(uint32_t))
+    {
+        epochSeconds = static_cast<uint32_t>(data[0]) |
+                       (static_cast<uint32_t>(data[1]) << 8) |
+                       (static_cast<uint32_t>(data[2]) << 16) |
+                       (static_cast<uint32_t>(data[3]) << 24);
+        return true;
+    }
+
+    JsonDocument doc;
+    if (deserializeJson(doc, reinterpret_cast<const char *>(data), length))
+    {
+        return false;
+    }
+    epochSeconds = doc["timestamp"].as<unsigned long>();
+    return true;
+}
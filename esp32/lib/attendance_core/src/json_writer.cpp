@@ -0,0 +1,234 @@
+#include "json_writer.h"
+
+#include <string.h>
+
+static const char hexDigits[] = "0123456789abcdef";
+
+static size_t escapedLength(const char *text, size_t length)
+{
+    size_t escaped = 0;
+    for (size_t i = 0; i < length; ++i)
+    {
+        uint8_t c = static_cast<uint8_t>(text[i]);
+        if (c == '"' || c == '\\' || c == '\n' || c == '\r' || c == '\t')
+        {
+            escaped += 2;
+        }
+        else if (c < 0x20)
+        {
+            escaped += 6;
+        }
+        else
+        {
+            escaped += 1;
+        }
+    }
+    return escaped;
+}
+
+JsonWriter::JsonWriter(char *buffer, size_t capacity)
+    : buffer(buffer), capacity(capacity), used(0), reserved(0), depth(0), pendingComma(0),
+      afterKey(false), isFull(false)
+{
+}
+
+bool JsonWriter::fits(size_t bytes) const
+{
+    // Every open container still needs its closing bracket.
+    return !isFull && used + bytes + depth + reserved <= capacity;
+}
+
+void JsonWriter::put(char c)
+{
+    buffer[used++] = c;
+}
+
+void JsonWriter::put(const char *data, size_t length)
+{
+    memcpy(buffer + used, data, length);
+    used += length;
+}
+
+void JsonWriter::separate()
+{
+    if (afterKey)
+    {
+        afterKey = false;
+        return;
+    }
+    if (depth == 0)
+    {
+        return;
+    }
+    uint8_t bit = static_cast<uint8_t>(1u << (depth - 1));
+    if (pendingComma & bit)
+    {
+        put(',');
+    }
+    pendingComma |= bit;
+}
+
+static size_t separatorLength(bool afterKey, uint8_t depth, uint8_t pendingComma)
+{
+    if (afterKey || depth == 0)
+    {
+        return 0;
+    }
+    return (pendingComma & (1u << (depth - 1))) ? 1 : 0;
+}
+
+void JsonWriter::open(char bracket)
+{
+    // The bracket and, once open, its closer.
+    if (depth == JSON_WRITER_MAX_DEPTH || !fits(separatorLength(afterKey, depth, pendingComma) + 2))
+    {
+        isFull = true;
+        return;
+    }
+    separate();
+    put(bracket);
+    ++depth;
+    pendingComma &= static_cast<uint8_t>(~(1u << (depth - 1)));
+}
+
+void JsonWriter::close(char bracket)
+{
+    // Always fits: the closer was held back when the container opened.
+    if (depth == 0)
+    {
+        return;
+    }
+    --depth;
+    put(bracket);
+}
+
+void JsonWriter::beginObject()
+{
+    open('{');
+}
+
+void JsonWriter::endObject()
+{
+    close('}');
+}
+
+void JsonWriter::beginArray()
+{
+    open('[');
+}
+
+void JsonWriter::endArray()
+{
+    close(']');
+}
+
+void JsonWriter::key(const char *name)
+{
+    size_t length = strlen(name);
+    size_t bytes = separatorLength(false, depth, pendingComma) + escapedLength(name, length) + 3;
+    if (!fits(bytes))
+    {
+        isFull = true;
+        return;
+    }
+    afterKey = false;
+    value(name, length);
+    put(':');
+    afterKey = true;
+}
+
+void JsonWriter::value(const char *text)
+{
+    value(text, strlen(text));
+}
+
+void JsonWriter::value(const char *text, size_t length)
+{
+    size_t bytes = separatorLength(afterKey, depth, pendingComma) + escapedLength(text, length) + 2;
+    if (!fits(bytes))
+    {
+        isFull = true;
+        return;
+    }
+    separate();
+    put('"');
+    for (size_t i = 0; i < length; ++i)
+    {
+        uint8_t c = static_cast<uint8_t>(text[i]);
+        switch (c)
+        {
+        case '"':
+            put("\\\"", 2);
+            break;
+        case '\\':
+            put("\\\\", 2);
+            break;
+        case '\n':
+            put("\\n", 2);
+            break;
+        case '\r':
+            put("\\r", 2);
+            break;
+        case '\t':
+            put("\\t", 2);
+            break;
+        default:
+            if (c < 0x20)
+            {
+                char escape[6] = {'\\', 'u', '0', '0', hexDigits[c >> 4], hexDigits[c & 0x0F]};
+                put(escape, sizeof(escape));
+            }
+            else
+            {
+                put(static_cast<char>(c));
+            }
+        }
+    }
+    put('"');
+}
+
+void JsonWriter::value(unsigned long number)
+{
+    char digits[20];
+    size_t count = 0;
+    do
+    {
+        digits[count++] = static_cast<char>('0' + number % 10);
+        number /= 10;
+    } while (number != 0);
+
+    if (!fits(separatorLength(afterKey, depth, pendingComma) + count))
+    {
+        isFull = true;
+        return;
+    }
+    separate();
+    while (count > 0)
+    {
+        put(digits[--count]);
+    }
+}
+
+void JsonWriter::reserve(size_t bytes)
+{
+    reserved += bytes;
+}
+
+void JsonWriter::release(size_t bytes)
+{
+    reserved = bytes < reserved ? reserved - bytes : 0;
+}
+
+JsonWriter::Mark JsonWriter::mark() const
+{
+    return {used, depth, pendingComma};
+}
+
+void JsonWriter::rewind(const Mark &mark)
+{
+    used = mark.length;
+    depth = mark.depth;
+    pendingComma = mark.pendingComma;
+    afterKey = false;
+    isFull = false;
+}
@@ -0,0 +1,120 @@
+#include "record_pool.h"
+
+#include <string.h>
+
+AttendanceRecord *recordPool = nullptr;
+
+static uint16_t *chunkNext = nullptr;
+static uint16_t chunkCount = 0;
+static uint16_t freeChunkHead = NO_CHUNK;
+static uint16_t freeChunkCount = 0;
+
+size_t initRecordPool(AttendanceRecord *records, uint16_t *chunkLinks, size_t capacity)
+{
+    if (capacity > RECORD_POOL_MAX_CAPACITY)
+    {
+        capacity = RECORD_POOL_MAX_CAPACITY;
+    }
+
+    recordPool = records;
+    chunkNext = chunkLinks;
+    chunkCount = static_cast<uint16_t>(capacity / RECORD_CHUNK_SIZE);
+    for (uint16_t i = 0; i < chunkCount; ++i)
+    {
+        chunkNext[i] = i + 1 < chunkCount ? i + 1 : NO_CHUNK;
+    }
+    freeChunkHead = chunkCount > 0 ? 0 : NO_CHUNK;
+    freeChunkCount = chunkCount;
+    return recordPoolCapacity();
+}
+
+size_t recordPoolCapacity()
+{
+    return static_cast<size_t>(chunkCount) * RECORD_CHUNK_SIZE;
+}
+
+void initRecordList(RecordList &list)
+{
+    list.head = NO_CHUNK;
+    list.tail = NO_CHUNK;
+    list.count = 0;
+}
+
+AttendanceRecord *appendRecord(RecordList &list)
+{
+    if (list.count >= MAX_RECORDS_PER_SESSION)
+    {
+        return nullptr;
+    }
+
+    size_t offset = list.count % RECORD_CHUNK_SIZE;
+    if (offset == 0)
+    {
+        if (freeChunkHead == NO_CHUNK)
+        {
+            return nullptr;
+        }
+
+        uint16_t chunk = freeChunkHead;
+        freeChunkHead = chunkNext[chunk];
+        --freeChunkCount;
+        chunkNext[chunk] = NO_CHUNK;
+
+        if (list.tail == NO_CHUNK)
+        {
+            list.head = chunk;
+        }
+        else
+        {
+            chunkNext[list.tail] = chunk;
+        }
+        list.tail = chunk;
+    }
+
+    AttendanceRecord *record = &recordPool[list.tail * RECORD_CHUNK_SIZE + offset];
+    memset(record, 0, sizeof(*record));
+    ++list.count;
+    return record;
+}
+
+void releaseRecords(RecordList &list)
+{
+    if (list.head != NO_CHUNK)
+    {
+        chunkNext[list.tail] = freeChunkHead;
+        freeChunkHead = list.head;
+        freeChunkCount += (list.count + RECORD_CHUNK_SIZE - 1) / RECORD_CHUNK_SIZE;
+    }
+    initRecordList(list);
+}
+
+RecordCursor recordCursorAt(const RecordList &list, size_t index)
+{
+    RecordCursor cursor = {list.head, index < list.count ? index : list.count};
+    for (size_t skipped = RECORD_CHUNK_SIZE; skipped <= cursor.index && cursor.chunk != NO_CHUNK; skipped += RECORD_CHUNK_SIZE)
+    {
+        cursor.chunk = chunkNext[cursor.chunk];
+    }
+    return cursor;
+}
+
+const AttendanceRecord *nextRecord(const RecordList &list, RecordCursor &cursor)
+{
+    if (cursor.index >= list.count || cursor.chunk == NO_CHUNK)
+    {
+        return nullptr;
+    }
+
+    const AttendanceRecord *record = &recordPool[cursor.chunk * RECORD_CHUNK_SIZE + cursor.index % RECORD_CHUNK_SIZE];
+    ++cursor.index;
+    if (cursor.index % RECORD_CHUNK_SIZE == 0)
+    {
+        cursor.chunk = chunkNext[cursor.chunk];
+    }
+    return record;
+}
+
+size_t freeRecordCapacity()
+{
+    return static_cast<size_t>(freeChunkCount) * RECORD_CHUNK_SIZE;
+}
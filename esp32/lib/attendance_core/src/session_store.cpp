@@ -0,0 +1,124 @@
+#include "session_store.h"
+
+#include <string.h>
+
+#include "hash.h"
+
+SessionSlot *sessionTable = nullptr;
+size_t sessionCapacity = 0;
+std::atomic<uint32_t> sessionTableGeneration(0);
+
+void initSessionTable(SessionSlot *slots, size_t capacity)
+{
+    sessionTable = slots;
+    sessionCapacity = capacity;
+    touchSessionTable();
+}
+
+static SessionSlot *findSessionWithHash(const char *id, size_t length, uint32_t hash)
+{
+    for (SessionSlot &slot : sessionSlots())
+    {
+        if (slot.inUse && slot.idHash == hash && slot.idLength == length &&
+            memcmp(slot.sessionId, id, length) == 0)
+        {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+SessionSlot *findSession(const char *id, size_t length)
+{
+    if (length > SESSION_ID_MAX_LEN)
+    {
+        return nullptr;
+    }
+    return findSessionWithHash(id, length, fnv1a(id, length));
+}
+
+SessionSlot *claimSession(const char *id, size_t length)
+{
+    if (length > SESSION_ID_MAX_LEN)
+    {
+        return nullptr;
+    }
+
+    uint32_t hash = fnv1a(id, length);
+    SessionSlot *existing = findSessionWithHash(id, length, hash);
+    if (existing != nullptr)
+    {
+        return existing;
+    }
+
+    for (SessionSlot &slot : sessionSlots())
+    {
+        if (!slot.inUse)
+        {
+            slot.inUse = true;
+            slot.idHash = hash;
+            slot.idLength = static_cast<uint8_t>(length);
+            memcpy(slot.sessionId, id, length);
+            slot.sessionId[length] = '\0';
+            initRecordList(slot.attendances);
+            clearDedupIndex(slot.marked);
+            touchSessionTable();
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+void releaseSession(SessionSlot *slot)
+{
+    slot->inUse = false;
+    releaseRecords(slot->attendances);
+    touchSessionTable();
+}
+
+size_t activeSessionCount()
+{
+    size_t count = 0;
+    for (const SessionSlot &slot : sessionSlots())
+    {
+        if (slot.inUse)
+        {
+            ++count;
+        }
+    }
+    return count;
+}
+
+AddAttendanceResult addAttendance(SessionSlot &slot, const char *name, size_t nameLength,
+                                  const char *matric, size_t matricLength, uint32_t timestamp,
+                                  AttendanceRecord *&record)
+{
+    uint16_t *markedEntry = findDedupEntry(slot.marked, matric, matricLength);
+    if (*markedEntry != 0)
+    {
+        return ATTENDANCE_DUPLICATE;
+    }
+
+    record = appendRecord(slot.attendances);
+    if (record == nullptr)
+    {
+        return ATTENDANCE_NO_STORAGE;
+    }
+
+    copyField(record->name, sizeof(record->name), name, nameLength);
+    copyField(record->matricNumber, sizeof(record->matricNumber), matric, matricLength);
+    record->sequence = slot.attendances.count;
+    record->timestamp = timestamp;
+    markDedupEntry(markedEntry, record);
+    return ATTENDANCE_ADDED;
+}
+
+void copyField(char *dest, size_t capacity, const char *src, size_t length)
+{
+    if (length >= capacity)
+    {
+        length = capacity - 1;
+    }
+    memcpy(dest, src, length);
+    dest[length] = '\0';
+}
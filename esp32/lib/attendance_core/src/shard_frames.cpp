@@ -0,0 +1,114 @@
+#include "shard_frames.h"
+
+#include <string.h>
+
+#define HEARTBEAT_PAYLOAD_BYTES 4
+#define RESEND_PAYLOAD_BYTES (1 + 4)
+
+static void writeUint32(uint8_t *out, uint32_t value)
+{
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+    out[2] = static_cast<uint8_t>(value >> 16);
+    out[3] = static_cast<uint8_t>(value >> 24);
+}
+
+static uint32_t readUint32(const uint8_t *data)
+{
+    return static_cast<uint32_t>(data[0]) |
+           (static_cast<uint32_t>(data[1]) << 8) |
+           (static_cast<uint32_t>(data[2]) << 16) |
+           (static_cast<uint32_t>(data[3]) << 24);
+}
+
+static size_t payloadLength(const ShardFrame &frame)
+{
+    switch (frame.type)
+    {
+    case SHARD_FRAME_ENTRY:
+        return frame.entryLength;
+    case SHARD_FRAME_HEARTBEAT:
+        return HEARTBEAT_PAYLOAD_BYTES;
+    case SHARD_FRAME_RESEND:
+        return RESEND_PAYLOAD_BYTES;
+    }
+    return 0;
+}
+
+size_t encodeShardFrame(const ShardFrame &frame, uint8_t *out, size_t capacity)
+{
+    size_t payload = payloadLength(frame);
+    size_t length = SHARD_HEADER_BYTES + payload;
+    if (payload == 0 || length + SHARD_MAC_BYTES > capacity)
+    {
+        return 0;
+    }
+
+    out[0] = SHARD_FRAME_VERSION;
+    out[1] = frame.type;
+    out[2] = frame.shardId;
+    writeUint32(out + 3, frame.incarnation);
+    writeUint32(out + 7, frame.sequence);
+    uint8_t *body = out + SHARD_HEADER_BYTES;
+    switch (frame.type)
+    {
+    case SHARD_FRAME_ENTRY:
+        memcpy(body, frame.entry, frame.entryLength);
+        break;
+    case SHARD_FRAME_HEARTBEAT:
+        writeUint32(body, frame.oldestSequence);
+        break;
+    case SHARD_FRAME_RESEND:
+        body[0] = frame.targetShard;
+        writeUint32(body + 1, frame.targetIncarnation);
+        break;
+    }
+    return length;
+}
+
+bool decodeShardFrame(const uint8_t *data, size_t length, ShardFrame &out, size_t &signedLength)
+{
+    if (length <= SHARD_HEADER_BYTES + SHARD_MAC_BYTES || length > SHARD_FRAME_MAX_BYTES ||
+        data[0] != SHARD_FRAME_VERSION || data[2] >= SHARD_MAX_COUNT)
+    {
+        return false;
+    }
+
+    signedLength = length - SHARD_MAC_BYTES;
+    const uint8_t *body = data + SHARD_HEADER_BYTES;
+    size_t bodyLength = signedLength - SHARD_HEADER_BYTES;
+
+    out.type = static_cast<ShardFrameType>(data[1]);
+    out.shardId = data[2];
+    out.incarnation = readUint32(data + 3);
+    out.sequence = readUint32(data + 7);
+    out.entry = nullptr;
+    out.entryLength = 0;
+    out.oldestSequence = 0;
+    out.targetShard = 0;
+    out.targetIncarnation = 0;
+
+    switch (out.type)
+    {
+    case SHARD_FRAME_ENTRY:
+        out.entry = body;
+        out.entryLength = bodyLength;
+        return true;
+    case SHARD_FRAME_HEARTBEAT:
+        if (bodyLength != HEARTBEAT_PAYLOAD_BYTES)
+        {
+            return false;
+        }
+        out.oldestSequence = readUint32(body);
+        return true;
+    case SHARD_FRAME_RESEND:
+        if (bodyLength != RESEND_PAYLOAD_BYTES || body[0] >= SHARD_MAX_COUNT)
+        {
+            return false;
+        }
+        out.targetShard = body[0];
+        out.targetIncarnation = readUint32(body + 1);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,70 @@
+#include "store_capacity.h"
+
+#include <stdint.h>
+
+#include "record_pool.h"
+
+StoreCapacity planStoreCapacity(size_t budgetBytes, size_t sessionBytes, size_t chunkBytes)
+{
+    StoreCapacity capacity = {0, 0, 0, 0};
+    if (budgetBytes < sessionBytes + chunkBytes)
+    {
+        return capacity;
+    }
+
+    size_t chunksPerSession = (STORE_RECORDS_PER_SESSION + RECORD_CHUNK_SIZE - 1) / RECORD_CHUNK_SIZE;
+    size_t sessions = budgetBytes / (sessionBytes + chunksPerSession * chunkBytes);
+    if (sessions == 0)
+    {
+        sessions = 1;
+    }
+    if (sessions > STORE_MAX_SESSIONS)
+    {
+        sessions = STORE_MAX_SESSIONS;
+    }
+
+    size_t chunks = (budgetBytes - sessions * sessionBytes) / chunkBytes;
+    if (chunks > RECORD_POOL_MAX_CAPACITY / RECORD_CHUNK_SIZE)
+    {
+        chunks = RECORD_POOL_MAX_CAPACITY / RECORD_CHUNK_SIZE;
+    }
+
+    capacity.sessions = sessions;
+    capacity.records = chunks * RECORD_CHUNK_SIZE;
+    capacity.bytes = sessions * sessionBytes + chunks * chunkBytes;
+    return capacity;
+}
+
+StoreCapacity planTieredStoreCapacity(size_t internalBudgetBytes, size_t externalBudgetBytes,
+                                      size_t sessionBytes, size_t recordBytes)
+{
+    StoreCapacity capacity = {0, 0, 0, 0};
+    size_t chunkRecordBytes = RECORD_CHUNK_SIZE * recordBytes;
+    if (internalBudgetBytes < sessionBytes + sizeof(uint16_t) || externalBudgetBytes < chunkRecordBytes)
+    {
+        return capacity;
+    }
+
+    size_t chunks = externalBudgetBytes / chunkRecordBytes;
+    if (chunks > RECORD_POOL_MAX_CAPACITY / RECORD_CHUNK_SIZE)
+    {
+        chunks = RECORD_POOL_MAX_CAPACITY / RECORD_CHUNK_SIZE;
+    }
+    // Links are tiny, but leave room for at least one slot.
+    if (chunks * sizeof(uint16_t) > internalBudgetBytes - sessionBytes)
+    {
+        chunks = (internalBudgetBytes - sessionBytes) / sizeof(uint16_t);
+    }
+
+    size_t sessions = (internalBudgetBytes - chunks * sizeof(uint16_t)) / sessionBytes;
+    if (sessions > STORE_MAX_SESSIONS)
+    {
+        sessions = STORE_MAX_SESSIONS;
+    }
+
+    capacity.sessions = sessions;
+    capacity.records = chunks * RECORD_CHUNK_SIZE;
+    capacity.bytes = sessions * sessionBytes + chunks * sizeof(uint16_t);
+    capacity.externalBytes = chunks * chunkRecordBytes;
+    return capacity;
+}
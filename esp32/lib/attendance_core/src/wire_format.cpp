@@ -0,0 +1,150 @@
+#include "wire_format.h"
+
+#include <string.h>
+
+static bool readString(const uint8_t *data, size_t length, size_t &pos, WireString &out)
+{
+    if (pos >= length)
+    {
+        return false;
+    }
+    uint8_t stringLength = data[pos++];
+    if (length - pos < stringLength)
+    {
+        return false;
+    }
+    out.data = reinterpret_cast<const char *>(data + pos);
+    out.length = stringLength;
+    pos += stringLength;
+    return true;
+}
+
+static uint32_t readUint32(const uint8_t *data)
+{
+    return static_cast<uint32_t>(data[0]) |
+           (static_cast<uint32_t>(data[1]) << 8) |
+           (static_cast<uint32_t>(data[2]) << 16) |
+           (static_cast<uint32_t>(data[3]) << 24);
+}
+
+static void writeUint32(uint8_t *out, uint32_t value)
+{
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+    out[2] = static_cast<uint8_t>(value >> 16);
+    out[3] = static_cast<uint8_t>(value >> 24);
+}
+
+// Reads name, matric and timestamp, the part every record layout shares.
+static bool readRecordBody(const uint8_t *data, size_t length, size_t &pos, MarkAttendanceMessage &out)
+{
+    if (!readString(data, length, pos, out.name) ||
+        length - pos < WIRE_MATRIC_BYTES + sizeof(uint32_t))
+    {
+        return false;
+    }
+
+    const char *matric = reinterpret_cast<const char *>(data + pos);
+    out.matricNumber.data = matric;
+    out.matricNumber.length = static_cast<uint8_t>(strnlen(matric, WIRE_MATRIC_BYTES));
+    pos += WIRE_MATRIC_BYTES;
+
+    out.timestamp = readUint32(data + pos);
+    pos += sizeof(uint32_t);
+    return true;
+}
+
+bool decodeMarkAttendance(const uint8_t *data, size_t length, MarkAttendanceMessage &out)
+{
+    size_t pos = 0;
+    if (length < 1 || data[pos++] != WIRE_FORMAT_VERSION)
+    {
+        return false;
+    }
+
+    return readString(data, length, pos, out.sessionId) &&
+           readRecordBody(data, length, pos, out) &&
+           pos == length;
+}
+
+size_t encodeMarkAttendance(const MarkAttendanceMessage &message, uint8_t *out, size_t capacity)
+{
+    size_t length = 1 + 1 + message.sessionId.length + 1 + message.name.length + WIRE_MATRIC_BYTES + sizeof(uint32_t);
+    if (length > capacity || message.matricNumber.length > WIRE_MATRIC_BYTES)
+    {
+        return 0;
+    }
+
+    size_t pos = 0;
+    out[pos++] = WIRE_FORMAT_VERSION;
+    out[pos++] = message.sessionId.length;
+    memcpy(out + pos, message.sessionId.data, message.sessionId.length);
+    pos += message.sessionId.length;
+    out[pos++] = message.name.length;
+    memcpy(out + pos, message.name.data, message.name.length);
+    pos += message.name.length;
+    memset(out + pos, 0, WIRE_MATRIC_BYTES);
+    memcpy(out + pos, message.matricNumber.data, message.matricNumber.length);
+    pos += WIRE_MATRIC_BYTES;
+    writeUint32(out + pos, message.timestamp);
+    return length;
+}
+
+size_t encodeAttendanceDelta(uint32_t sequence, const MarkAttendanceMessage &message, uint8_t *out, size_t capacity)
+{
+    if (capacity < sizeof(uint32_t))
+    {
+        return 0;
+    }
+    size_t length = encodeMarkAttendance(message, out + sizeof(uint32_t), capacity - sizeof(uint32_t));
+    if (length == 0)
+    {
+        return 0;
+    }
+    writeUint32(out, sequence);
+    return length + sizeof(uint32_t);
+}
+
+bool decodeMarkBatch(const uint8_t *data, size_t length, MarkBatch &out)
+{
+    size_t pos = 0;
+    if (length < 1 || data[pos++] != WIRE_FORMAT_VERSION)
+    {
+        return false;
+    }
+
+    if (!readString(data, length, pos, out.sessionId) || pos >= length)
+    {
+        return false;
+    }
+
+    out.count = data[pos++];
+    if (out.count == 0 || out.count > WIRE_BATCH_MAX_RECORDS)
+    {
+        return false;
+    }
+
+    out.records = data + pos;
+    out.recordsLength = length - pos;
+
+    size_t recordPos = 0;
+    MarkAttendanceMessage record;
+    for (uint8_t i = 0; i < out.count; ++i)
+    {
+        if (!readRecordBody(out.records, out.recordsLength, recordPos, record))
+        {
+            return false;
+        }
+    }
+    return recordPos == out.recordsLength;
+}
+
+bool nextBatchRecord(const MarkBatch &batch, size_t &pos, MarkAttendanceMessage &out)
+{
+    if (pos >= batch.recordsLength)
+    {
+        return false;
+    }
+    out.sessionId = batch.sessionId;
+    return readRecordBody(batch.records, batch.recordsLength, pos, out);
+}
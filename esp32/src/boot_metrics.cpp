@@ -0,0 +1,25 @@
+#include "boot_metrics.h"
+
+#include "clock.h"
+#include "log.h"
+
+static uint32_t milestoneMillis[BOOT_MILESTONE_COUNT];
+
+static const char *const milestoneNames[BOOT_MILESTONE_COUNT] = {"ble-ready", "advertising", "restored"};
+
+void recordBootMilestone(BootMilestone milestone)
+{
+    if (milestone >= BOOT_MILESTONE_COUNT || milestoneMillis[milestone] != 0)
+    {
+        return;
+    }
+    // Never 0, so a reached milestone always reads as reached.
+    uint32_t now = static_cast<uint32_t>(monotonicMillis());
+    milestoneMillis[milestone] = now != 0 ? now : 1;
+    LOG_INFO("Boot: %s at %lu ms", milestoneNames[milestone], static_cast<unsigned long>(milestoneMillis[milestone]));
+}
+
+uint32_t bootMilestoneMillis(BootMilestone milestone)
+{
+    return milestone < BOOT_MILESTONE_COUNT ? milestoneMillis[milestone] : 0;
+}
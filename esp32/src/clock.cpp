@@ -0,0 +1,48 @@
+#include "clock.h"
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+#include "epoch_clock.h"
+
+static portMUX_TYPE clockLock = portMUX_INITIALIZER_UNLOCKED;
+static EpochClock wallClock = {};
+
+uint64_t monotonicMillis()
+{
+    return static_cast<uint64_t>(esp_timer_get_time()) / 1000;
+}
+
+void syncEpoch(uint32_t epochSeconds)
+{
+    uint64_t now = monotonicMillis();
+    portENTER_CRITICAL(&clockLock);
+    syncEpochClock(wallClock, epochSeconds, now);
+    portEXIT_CRITICAL(&clockLock);
+}
+
+bool observeEpoch(uint32_t epochSeconds)
+{
+    uint64_t now = monotonicMillis();
+    portENTER_CRITICAL(&clockLock);
+    bool firstAnchor = observeEpochClock(wallClock, epochSeconds, now);
+    portEXIT_CRITICAL(&clockLock);
+    return firstAnchor;
+}
+
+bool isClockSynced()
+{
+    portENTER_CRITICAL(&clockLock);
+    bool value = wallClock.synced;
+    portEXIT_CRITICAL(&clockLock);
+    return value;
+}
+
+bool currentEpoch(uint32_t &epochSeconds)
+{
+    uint64_t now = monotonicMillis();
+    portENTER_CRITICAL(&clockLock);
+    bool valid = readEpochClock(wallClock, now, epochSeconds);
+    portEXIT_CRITICAL(&clockLock);
+    return valid;
+}
@@ -0,0 +1,313 @@
+#include "connectionless.h"
+
+#include <NimBLEDevice.h>
+#include <mbedtls/md.h>
+#include <string.h>
+
+#include "beacon_frames.h"
+#include "clock.h"
+#include "hash.h"
+#include "journal.h"
+#include "log.h"
+#include "session_store.h"
+#include "store_lock.h"
+
+#if CONNECTIONLESS_MARKING
+
+#ifndef BEACON_MARK_KEY
+#error "Connectionless marking needs -DBEACON_MARK_KEY, the key student apps sign mark frames with"
+#endif
+
+// Passive scan timing until the power manager sets its own, in
+// milliseconds. Leaves most of the radio time to advertising and open
+// connections.
+#define BEACON_SCAN_INTERVAL_MS 100
+#define BEACON_SCAN_WINDOW_MS 30
+
+// Phones repeat the same frame many times a second; remembering the last few
+// skips the HMAC for repeats.
+#define RECENT_FRAME_SLOTS 16
+
+static ConnectionlessMarkHandler markHandler = nullptr;
+static NimBLEScan *pScan = nullptr;
+
+// Host task only.
+static uint32_t recentFrames[RECENT_FRAME_SLOTS];
+static size_t recentFrameNext = 0;
+
+// loop() only.
+static size_t rotateIndex = 0;
+static uint64_t lastRotateMillis = 0;
+static uint8_t sessionFrame[BEACON_MANUFACTURER_MAX];
+static size_t sessionFrameLength = 0;
+static bool scanEnabled = true;
+
+static bool seenRecently(uint32_t frameHash)
+{
+    for (uint32_t seen : recentFrames)
+    {
+        if (seen == frameHash)
+        {
+            return true;
+        }
+    }
+    recentFrames[recentFrameNext] = frameHash;
+    recentFrameNext = (recentFrameNext + 1) % RECENT_FRAME_SLOTS;
+    return false;
+}
+
+// The signed data includes the session tag, so a frame cannot be replayed
+// against another session.
+static bool verifyMac(const MarkFrame &frame)
+{
+    static const char key[] = BEACON_MARK_KEY;
+    const size_t keyLength = sizeof(key) - 1;
+    uint8_t digest[32];
+    const mbedtls_md_info_t *info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    if (mbedtls_md_hmac(info, reinterpret_cast<const unsigned char *>(key), keyLength,
+                        frame.signedData, frame.signedLength, digest) != 0)
+    {
+        return false;
+    }
+
+    uint8_t difference = 0;
+    for (size_t i = 0; i < BEACON_MAC_BYTES; ++i)
+    {
+        difference |= digest[i] ^ frame.mac[i];
+    }
+    return difference == 0;
+}
+
+static bool withinSkew(uint32_t timestamp)
+{
+    uint32_t now;
+    // Before a sync this checks against the first anchor, which later
+    // marks cannot move.
+    if (!currentEpoch(now))
+    {
+        return true;
+    }
+    uint32_t skew = timestamp > now ? timestamp - now : now - timestamp;
+    return skew <= BEACON_MARK_MAX_SKEW_S;
+}
+
+class MarkFrameCallbacks : public NimBLEAdvertisedDeviceCallbacks
+{
+    void onResult(NimBLEAdvertisedDevice *device) override
+    {
+        if (!device->haveManufacturerData())
+        {
+            return;
+        }
+        std::string data = device->getManufacturerData();
+        MarkFrame frame;
+        if (!decodeMarkFrame(reinterpret_cast<const uint8_t *>(data.data()), data.size(), frame))
+        {
+            return;
+        }
+        // Until the journal is replayed there is nothing to mark against;
+        // the phone keeps broadcasting, so the frame comes round again.
+        if (!isJournalRestored() || seenRecently(fnv1a(data.data(), data.size())))
+        {
+            return;
+        }
+        if (!withinSkew(frame.timestamp))
+        {
+            LOG_DEBUG("Mark frame outside the clock window");
+            return;
+        }
+
+        if (!verifyMac(frame))
+        {
+            LOG_WARN("Mark frame failed verification");
+            return;
+        }
+
+        char sessionId[SESSION_ID_MAX_LEN + 1];
+        uint8_t idLength = 0;
+        {
+            StoreLock lock;
+            for (const SessionSlot &slot : sessionSlots())
+            {
+                if (slot.inUse && slot.idHash == frame.sessionTag)
+                {
+                    memcpy(sessionId, slot.sessionId, slot.idLength);
+                    idLength = slot.idLength;
+                    break;
+                }
+            }
+        }
+        if (idLength == 0)
+        {
+            LOG_DEBUG("Mark frame for an unknown session");
+            return;
+        }
+        MarkAttendanceMessage message;
+        message.sessionId = {sessionId, idLength};
+        // Mark frames carry no name; see connectionless.h.
+        message.name = {"", 0};
+        message.matricNumber = frame.matricNumber;
+        message.timestamp = frame.timestamp;
+        WriteStatus status = markHandler(message);
+        if (!isWriteAccepted(status))
+        {
+            LOG_DEBUG("Connectionless mark rejected with status %u", static_cast<unsigned>(status));
+        }
+    }
+};
+
+static uint16_t minutesToExpiry(const SessionSlot &slot)
+{
+    uint32_t now;
+    if (!currentEpoch(now))
+    {
+        return BEACON_EXPIRY_UNKNOWN;
+    }
+    if (slot.session.expiryTimestamp <= now)
+    {
+        return 0;
+    }
+    unsigned long minutes = (slot.session.expiryTimestamp - now + 59) / 60;
+    return minutes < BEACON_EXPIRY_UNKNOWN ? static_cast<uint16_t>(minutes) : BEACON_EXPIRY_UNKNOWN - 1;
+}
+
+// Encodes the next session in rotation, or an empty frame with a count of
+// zero when there are no sessions.
+static size_t encodeNextSessionFrame(uint8_t *out, size_t capacity)
+{
+    SessionFrame frame = {};
+    frame.generation = static_cast<uint8_t>(sessionTableGeneration.load());
+    frame.minutesToExpiry = BEACON_EXPIRY_UNKNOWN;
+    frame.courseCode = {"", 0};
+
+    StoreLock lock;
+    size_t active = 0;
+    for (const SessionSlot &slot : sessionSlots())
+    {
+        active += slot.inUse ? 1 : 0;
+    }
+    if (active == 0)
+    {
+        return encodeSessionFrame(frame, out, capacity);
+    }
+
+    rotateIndex %= active;
+    size_t position = 0;
+    for (const SessionSlot &slot : sessionSlots())
+    {
+        if (!slot.inUse || position++ != rotateIndex)
+        {
+            continue;
+        }
+        frame.index = static_cast<uint8_t>(rotateIndex);
+        frame.count = static_cast<uint8_t>(active);
+        frame.sessionTag = slot.idHash;
+        frame.minutesToExpiry = minutesToExpiry(slot);
+        frame.courseCode = makeWireString(slot.session.courseCode);
+        size_t length = encodeSessionFrame(frame, out, capacity);
+        ++rotateIndex;
+        return length;
+    }
+    return 0;
+}
+
+static void rotateSessionFrame()
+{
+    uint8_t frame[BEACON_MANUFACTURER_MAX];
+    size_t length = encodeNextSessionFrame(frame, sizeof(frame));
+    if (length == sessionFrameLength && memcmp(frame, sessionFrame, length) == 0)
+    {
+        return;
+    }
+    memcpy(sessionFrame, frame, length);
+    sessionFrameLength = length;
+
+    NimBLEAdvertisementData scanResponse;
+    scanResponse.setManufacturerData(std::string(reinterpret_cast<const char *>(frame), length));
+    NimBLEDevice::getAdvertising()->setScanResponseData(scanResponse);
+}
+
+static void startScan()
+{
+    if (!pScan->start(0, nullptr, false))
+    {
+        LOG_WARN("Failed to start the mark frame scan");
+    }
+}
+
+void startConnectionless(const char *deviceName, ConnectionlessMarkHandler handler)
+{
+    markHandler = handler;
+
+    // The session frame takes the whole scan response, so the name moves
+    // into the advertisement. It has no room left for the 128-bit service
+    // UUID; apps find the beacon by name and the service by discovery.
+    NimBLEAdvertising *pAdvertising = NimBLEDevice::getAdvertising();
+    NimBLEAdvertisementData advertisement;
+    advertisement.setFlags(BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP);
+    advertisement.setName(deviceName);
+    pAdvertising->setAdvertisementData(advertisement);
+    rotateSessionFrame();
+
+    pScan = NimBLEDevice::getScan();
+    pScan->setAdvertisedDeviceCallbacks(new MarkFrameCallbacks(), true);
+    pScan->setActiveScan(false);
+    pScan->setInterval(BEACON_SCAN_INTERVAL_MS);
+    pScan->setWindow(BEACON_SCAN_WINDOW_MS);
+    pScan->setMaxResults(0);
+    // Each phone's frame changes with every session it marks, and the
+    // recent-frame check already absorbs repeats.
+    pScan->setDuplicateFilter(false);
+    startScan();
+    LOG_INFO("Connectionless marking enabled");
+}
+
+void setConnectionlessScan(uint16_t intervalMs, uint16_t windowMs)
+{
+    // Timing changes only apply to a fresh scan.
+    if (pScan->isScanning())
+    {
+        pScan->stop();
+    }
+    scanEnabled = windowMs != 0;
+    if (scanEnabled)
+    {
+        pScan->setInterval(intervalMs);
+        pScan->setWindow(windowMs);
+        startScan();
+    }
+}
+
+void serviceConnectionless()
+{
+    uint64_t now = monotonicMillis();
+    if (now - lastRotateMillis >= BEACON_ROTATE_MS)
+    {
+        lastRotateMillis = now;
+        rotateSessionFrame();
+    }
+    if (scanEnabled && !pScan->isScanning())
+    {
+        startScan();
+    }
+}
+
+#else
+
+void startConnectionless(const char *deviceName, ConnectionlessMarkHandler handler)
+{
+    (void)deviceName;
+    (void)handler;
+}
+
+void setConnectionlessScan(uint16_t intervalMs, uint16_t windowMs)
+{
+    (void)intervalMs;
+    (void)windowMs;
+}
+
+void serviceConnectionless()
+{
+}
+
+#endif
@@ -0,0 +1,153 @@
+#include "connections.h"
+
+#include <Arduino.h>
+#include <string.h>
+
+#include "clock.h"
+
+#define TOKEN_MILLIS 1000
+
+static ConnectionContext connections[MAX_CONNECTIONS];
+// The NimBLE host task updates contexts while loop() looks for connections
+// to drop.
+static portMUX_TYPE connectionsLock = portMUX_INITIALIZER_UNLOCKED;
+
+ConnectionContext *openConnection(uint16_t connHandle)
+{
+    uint64_t now = monotonicMillis();
+    ConnectionContext *opened = nullptr;
+    portENTER_CRITICAL(&connectionsLock);
+    for (ConnectionContext &connection : connections)
+    {
+        if (!connection.inUse)
+        {
+            memset(&connection, 0, sizeof(connection));
+            connection.inUse = true;
+            connection.connHandle = connHandle;
+            connection.mtu = DEFAULT_ATT_MTU;
+            connection.tokenMillis = WRITE_RATE_BURST * TOKEN_MILLIS;
+            connection.lastRefillMillis = now;
+            connection.lastActivityMillis = now;
+            opened = &connection;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&connectionsLock);
+    return opened;
+}
+
+void closeConnection(uint16_t connHandle)
+{
+    portENTER_CRITICAL(&connectionsLock);
+    for (ConnectionContext &connection : connections)
+    {
+        if (connection.inUse && connection.connHandle == connHandle)
+        {
+            connection.inUse = false;
+        }
+    }
+    portEXIT_CRITICAL(&connectionsLock);
+}
+
+ConnectionContext *findConnection(uint16_t connHandle)
+{
+    for (ConnectionContext &connection : connections)
+    {
+        if (connection.inUse && connection.connHandle == connHandle)
+        {
+            return &connection;
+        }
+    }
+    return nullptr;
+}
+
+size_t connectionCount()
+{
+    size_t count = 0;
+    for (const ConnectionContext &connection : connections)
+    {
+        if (connection.inUse)
+        {
+            ++count;
+        }
+    }
+    return count;
+}
+
+bool takeWriteToken(ConnectionContext &connection)
+{
+    uint64_t now = monotonicMillis();
+    portENTER_CRITICAL(&connectionsLock);
+    uint64_t refill = (now - connection.lastRefillMillis) * WRITE_RATE_PER_SECOND;
+    uint64_t tokens = connection.tokenMillis + refill;
+    connection.tokenMillis = tokens < WRITE_RATE_BURST * TOKEN_MILLIS ? static_cast<uint32_t>(tokens) : WRITE_RATE_BURST * TOKEN_MILLIS;
+    connection.lastRefillMillis = now;
+    connection.lastActivityMillis = now;
+
+    // A lecturer syncing every session sends a page request per session on
+    // top of its time sync and resyncs, well past the burst.
+    bool allowed = connection.persistent || connection.tokenMillis >= TOKEN_MILLIS;
+    if (allowed && !connection.persistent)
+    {
+        connection.tokenMillis -= TOKEN_MILLIS;
+    }
+    portEXIT_CRITICAL(&connectionsLock);
+    return allowed;
+}
+
+void touchConnection(ConnectionContext &connection)
+{
+    uint64_t now = monotonicMillis();
+    portENTER_CRITICAL(&connectionsLock);
+    connection.lastActivityMillis = now;
+    portEXIT_CRITICAL(&connectionsLock);
+}
+
+bool markPersistent(ConnectionContext &connection)
+{
+    portENTER_CRITICAL(&connectionsLock);
+    bool promoted = !connection.persistent;
+    connection.persistent = true;
+    connection.disconnectAtMillis = 0;
+    portEXIT_CRITICAL(&connectionsLock);
+    return promoted;
+}
+
+void scheduleDisconnectAfterMark(ConnectionContext &connection)
+{
+    if (POST_MARK_DISCONNECT_MS == 0)
+    {
+        return;
+    }
+
+    uint64_t now = monotonicMillis();
+    portENTER_CRITICAL(&connectionsLock);
+    if (!connection.persistent && connection.disconnectAtMillis == 0)
+    {
+        connection.disconnectAtMillis = now + POST_MARK_DISCONNECT_MS;
+    }
+    portEXIT_CRITICAL(&connectionsLock);
+}
+
+size_t collectDueDisconnects(uint16_t *handles, size_t capacity)
+{
+    uint64_t now = monotonicMillis();
+    size_t count = 0;
+    portENTER_CRITICAL(&connectionsLock);
+    for (const ConnectionContext &connection : connections)
+    {
+        if (count == capacity || !connection.inUse || connection.persistent)
+        {
+            continue;
+        }
+
+        bool markDone = connection.disconnectAtMillis != 0 && now >= connection.disconnectAtMillis;
+        bool idle = IDLE_DISCONNECT_MS != 0 && now - connection.lastActivityMillis >= IDLE_DISCONNECT_MS;
+        if (markDone || idle)
+        {
+            handles[count++] = connection.connHandle;
+        }
+    }
+    portEXIT_CRITICAL(&connectionsLock);
+    return count;
+}
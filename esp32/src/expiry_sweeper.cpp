@@ -0,0 +1,69 @@
+#include "expiry_sweeper.h"
+
+#include <Arduino.h>
+
+#include "clock.h"
+#include "expiry_queue.h"
+#include "journal.h"
+#include "log.h"
+#include "session_store.h"
+#include "store_lock.h"
+
+// Upper bound on one sleep, so a long wait never overflows the tick count.
+#define SWEEPER_MAX_SLEEP_MS (60UL * 60UL * 1000UL)
+
+static TaskHandle_t sweeperTask = nullptr;
+
+// Frees every session due at or before now. Returns how long to sleep.
+static TickType_t evictExpiredSessions(uint32_t now)
+{
+    size_t slot;
+    uint32_t expiryTimestamp;
+    while (peekExpiry(slot, expiryTimestamp))
+    {
+        if (expiryTimestamp > now)
+        {
+            uint32_t waitSeconds = expiryTimestamp - now;
+            uint32_t waitMillis = waitSeconds < SWEEPER_MAX_SLEEP_MS / 1000 ? waitSeconds * 1000 : SWEEPER_MAX_SLEEP_MS;
+            return pdMS_TO_TICKS(waitMillis);
+        }
+
+        popExpiry();
+        LOG_INFO("Removing expired session: %s", sessionTable[slot].sessionId);
+        journalClose(sessionTable[slot]);
+        releaseSession(&sessionTable[slot]);
+    }
+    return portMAX_DELAY;
+}
+
+static void sweeperLoop(void *)
+{
+    for (;;)
+    {
+        TickType_t wait = portMAX_DELAY;
+        uint32_t now;
+        if (currentEpoch(now))
+        {
+            StoreLock lock;
+            wait = evictExpiredSessions(now);
+            LOG_DEBUG("Active sessions after sweep: %u", static_cast<unsigned>(activeSessionCount()));
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+void startExpirySweeper()
+{
+    if (sweeperTask == nullptr)
+    {
+        xTaskCreatePinnedToCore(sweeperLoop, "sweeper", 3072, nullptr, 1, &sweeperTask, 1);
+    }
+}
+
+void wakeExpirySweeper()
+{
+    if (sweeperTask != nullptr)
+    {
+        xTaskNotifyGive(sweeperTask);
+    }
+}
@@ -0,0 +1,64 @@
+#include "gatt_table.h"
+
+#include "log.h"
+
+GattDispatcher::GattDispatcher(const CharacteristicDescriptor *table, NimBLECharacteristic **characteristics,
+                               size_t count)
+    : table(table), characteristics(characteristics), count(count)
+{
+}
+
+void GattDispatcher::registerCharacteristics(NimBLEService *service)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        characteristics[i] = service->createCharacteristic(table[i].uuid, table[i].properties);
+        characteristics[i]->setCallbacks(this);
+        LOG_DEBUG("%s characteristic set up", table[i].name);
+    }
+}
+
+const CharacteristicDescriptor *GattDispatcher::find(const NimBLECharacteristic *characteristic) const
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (characteristics[i] == characteristic)
+        {
+            return &table[i];
+        }
+    }
+    return nullptr;
+}
+
+void GattDispatcher::onRead(NimBLECharacteristic *characteristic, ble_gap_conn_desc *desc)
+{
+    const CharacteristicDescriptor *row = find(characteristic);
+    if (row == nullptr || row->onRead == nullptr)
+    {
+        return;
+    }
+    CallbackTimer timer(row->readMetric);
+    LOG_DEBUG("%s: onRead called", row->name);
+    row->onRead(characteristic, desc);
+}
+
+void GattDispatcher::onWrite(NimBLECharacteristic *characteristic, ble_gap_conn_desc *desc)
+{
+    const CharacteristicDescriptor *row = find(characteristic);
+    if (row == nullptr || row->onWrite == nullptr)
+    {
+        return;
+    }
+    CallbackTimer timer(row->writeMetric);
+    LOG_DEBUG("%s: onWrite called", row->name);
+    row->onWrite(characteristic, desc);
+}
+
+void GattDispatcher::onSubscribe(NimBLECharacteristic *characteristic, ble_gap_conn_desc *desc, uint16_t subValue)
+{
+    const CharacteristicDescriptor *row = find(characteristic);
+    if (row != nullptr && row->onSubscribe != nullptr)
+    {
+        row->onSubscribe(characteristic, desc, subValue);
+    }
+}
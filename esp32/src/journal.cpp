@@ -0,0 +1,457 @@
+#include "journal.h"
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <string.h>
+
+#include "boot_metrics.h"
+#include "expiry_queue.h"
+#include "expiry_sweeper.h"
+#include "journal_format.h"
+#include "log.h"
+#include "store_lock.h"
+
+static_assert((JOURNAL_BUFFER_BYTES & (JOURNAL_BUFFER_BYTES - 1)) == 0, "JOURNAL_BUFFER_BYTES must be a power of two");
+
+#define JOURNAL_PATH "/journal.bin"
+#define JOURNAL_COMPACT_PATH "/journal.tmp"
+#define JOURNAL_WRITE_CHUNK 256
+#define JOURNAL_READ_CHUNK 1024
+
+static uint8_t journalBuffer[JOURNAL_BUFFER_BYTES];
+// Free-running byte counters; head - tail is the number of queued bytes.
+static uint32_t journalHead = 0;
+static uint32_t journalTail = 0;
+static uint32_t journalDropped = 0;
+static portMUX_TYPE journalLock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t journalTask = nullptr;
+
+static bool journalMounted = false;
+static volatile bool journalRestored = false;
+static File journalFile;
+// Bytes in the journal file, so the flusher can tell when it is worth
+// resetting without asking the filesystem.
+static size_t journalBytes = 0;
+
+static void journalAppend(const uint8_t *entry, size_t length)
+{
+    if (!journalMounted || length == 0)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&journalLock);
+    uint32_t queued = journalHead - journalTail;
+    if (JOURNAL_BUFFER_BYTES - queued < length)
+    {
+        ++journalDropped;
+        portEXIT_CRITICAL(&journalLock);
+        return;
+    }
+    uint32_t start = journalHead & (JOURNAL_BUFFER_BYTES - 1);
+    size_t first = length < JOURNAL_BUFFER_BYTES - start ? length : JOURNAL_BUFFER_BYTES - start;
+    memcpy(journalBuffer + start, entry, first);
+    memcpy(journalBuffer, entry + first, length - first);
+    journalHead += length;
+    queued += length;
+    portEXIT_CRITICAL(&journalLock);
+
+    // Flush early rather than let a burst of marks fill the queue.
+    if (journalTask != nullptr && queued > JOURNAL_BUFFER_BYTES / 2)
+    {
+        xTaskNotifyGive(journalTask);
+    }
+}
+
+static size_t journalTake(uint8_t *chunk, size_t capacity)
+{
+    portENTER_CRITICAL(&journalLock);
+    uint32_t queued = journalHead - journalTail;
+    uint32_t start = journalTail & (JOURNAL_BUFFER_BYTES - 1);
+    size_t length = queued < capacity ? queued : capacity;
+    if (length > JOURNAL_BUFFER_BYTES - start)
+    {
+        length = JOURNAL_BUFFER_BYTES - start;
+    }
+    memcpy(chunk, journalBuffer + start, length);
+    journalTail += length;
+    portEXIT_CRITICAL(&journalLock);
+    return length;
+}
+
+static bool journalQueueEmpty()
+{
+    portENTER_CRITICAL(&journalLock);
+    bool empty = journalHead == journalTail;
+    portEXIT_CRITICAL(&journalLock);
+    return empty;
+}
+
+size_t encodeSessionEntry(const SessionSlot &slot, uint8_t *out, size_t capacity)
+{
+    JournalSession session;
+    session.sessionId = {slot.sessionId, slot.idLength};
+    session.courseCode = makeWireString(slot.session.courseCode);
+    session.courseName = makeWireString(slot.session.courseName);
+    session.expiryTimestamp = static_cast<uint32_t>(slot.session.expiryTimestamp);
+    return encodeJournalSession(session, out, capacity);
+}
+
+size_t encodeMarkEntry(const SessionSlot &slot, const AttendanceRecord &record, uint8_t *out, size_t capacity)
+{
+    MarkAttendanceMessage mark;
+    mark.sessionId = {slot.sessionId, slot.idLength};
+    mark.name = makeWireString(record.name);
+    mark.matricNumber = makeWireString(record.matricNumber);
+    mark.timestamp = record.timestamp;
+    return encodeJournalMark(mark, out, capacity);
+}
+
+void journalSession(const SessionSlot &slot)
+{
+    uint8_t entry[JOURNAL_ENTRY_MAX_BYTES];
+    journalAppend(entry, encodeSessionEntry(slot, entry, sizeof(entry)));
+}
+
+void journalMark(const SessionSlot &slot, const AttendanceRecord &record)
+{
+    uint8_t entry[JOURNAL_ENTRY_MAX_BYTES];
+    journalAppend(entry, encodeMarkEntry(slot, record, entry, sizeof(entry)));
+}
+
+void journalClose(const SessionSlot &slot)
+{
+    uint8_t entry[JOURNAL_ENTRY_MAX_BYTES];
+    journalAppend(entry, encodeJournalClose({slot.sessionId, slot.idLength}, entry, sizeof(entry)));
+}
+
+uint32_t journalDropCount()
+{
+    portENTER_CRITICAL(&journalLock);
+    uint32_t dropped = journalDropped;
+    portEXIT_CRITICAL(&journalLock);
+    return dropped;
+}
+
+static void applyEntry(const JournalEntry &entry)
+{
+    switch (entry.type)
+    {
+    case JOURNAL_SESSION:
+    {
+        JournalSession session;
+        if (!decodeJournalSession(entry, session))
+        {
+            break;
+        }
+        SessionSlot *slot = claimSession(session.sessionId.data, session.sessionId.length);
+        if (slot == nullptr)
+        {
+            LOG_WARN("Journal: no slot for session %.*s", session.sessionId.length, session.sessionId.data);
+            break;
+        }
+        copyField(slot->session.courseCode, sizeof(slot->session.courseCode), session.courseCode.data, session.courseCode.length);
+        copyField(slot->session.courseName, sizeof(slot->session.courseName), session.courseName.data, session.courseName.length);
+        slot->session.expiryTimestamp = session.expiryTimestamp;
+        scheduleExpiry(sessionIndex(slot), session.expiryTimestamp);
+        touchSessionTable();
+        break;
+    }
+    case JOURNAL_MARK:
+    {
+        MarkAttendanceMessage mark;
+        if (!decodeJournalMark(entry, mark) || mark.matricNumber.length == 0 ||
+            mark.matricNumber.length > RECORD_MATRIC_MAX_LEN)
+        {
+            break;
+        }
+        SessionSlot *slot = findSession(mark.sessionId.data, mark.sessionId.length);
+        if (slot != nullptr)
+        {
+            AttendanceRecord *record;
+            addAttendance(*slot, mark.name.data, mark.name.length,
+                          mark.matricNumber.data, mark.matricNumber.length, mark.timestamp, record);
+        }
+        break;
+    }
+    case JOURNAL_CLOSE:
+    {
+        WireString sessionId;
+        if (!decodeJournalClose(entry, sessionId))
+        {
+            break;
+        }
+        SessionSlot *slot = findSession(sessionId.data, sessionId.length);
+        if (slot != nullptr)
+        {
+            cancelExpiry(sessionIndex(slot));
+            releaseSession(slot);
+        }
+        break;
+    }
+    }
+}
+
+// Applies entries until the end of the file or the first bad entry. Sets
+// intact to false if the file ends in a torn or corrupt entry.
+static size_t replayJournal(File &file, bool &intact)
+{
+    uint8_t buffer[JOURNAL_READ_CHUNK];
+    size_t filled = 0;
+    size_t applied = 0;
+    bool eof = false;
+    intact = true;
+
+    for (;;)
+    {
+        if (!eof && filled < sizeof(buffer))
+        {
+            size_t read = file.read(buffer + filled, sizeof(buffer) - filled);
+            eof = read == 0;
+            filled += read;
+        }
+
+        size_t pos = 0;
+        JournalEntry entry;
+        while (size_t consumed = decodeJournalEntry(buffer + pos, filled - pos, entry))
+        {
+            applyEntry(entry);
+            ++applied;
+            pos += consumed;
+        }
+
+        // Nothing more decodes: either the next entry straddles the end of
+        // the buffer, or the file stops here.
+        memmove(buffer, buffer + pos, filled - pos);
+        filled -= pos;
+        if (eof || (pos == 0 && filled == sizeof(buffer)))
+        {
+            intact = filled == 0;
+            return applied;
+        }
+    }
+}
+
+// Bytes in the file at path, or 0 if it cannot be opened.
+static size_t fileSize(const char *path)
+{
+    File file = LittleFS.open(path, FILE_READ);
+    if (!file)
+    {
+        return 0;
+    }
+    size_t size = file.size();
+    file.close();
+    return size;
+}
+
+// Rewrites the journal as one session entry per live session followed by
+// its marks, dropping closed sessions and any torn tail. The rewrite only
+// replaces the journal once every entry is on flash in full; a short write,
+// say from a full filesystem, leaves the old journal in place.
+static bool compactJournal()
+{
+    File file = LittleFS.open(JOURNAL_COMPACT_PATH, FILE_WRITE);
+    if (!file)
+    {
+        return false;
+    }
+
+    size_t expected = 0;
+    bool complete = true;
+    uint8_t entry[JOURNAL_ENTRY_MAX_BYTES];
+    for (const SessionSlot &slot : sessionSlots())
+    {
+        if (!slot.inUse || !complete)
+        {
+            continue;
+        }
+        size_t length = encodeSessionEntry(slot, entry, sizeof(entry));
+        complete = length > 0 && file.write(entry, length) == length;
+        expected += length;
+
+        RecordCursor cursor = recordCursorAt(slot.attendances, 0);
+        const AttendanceRecord *record = nullptr;
+        while (complete && (record = nextRecord(slot.attendances, cursor)) != nullptr)
+        {
+            length = encodeMarkEntry(slot, *record, entry, sizeof(entry));
+            complete = length > 0 && file.write(entry, length) == length;
+            expected += length;
+        }
+    }
+    file.flush();
+    file.close();
+
+    if (!complete || fileSize(JOURNAL_COMPACT_PATH) != expected)
+    {
+        LOG_WARN("Journal rewrite incomplete, keeping the old journal");
+        LittleFS.remove(JOURNAL_COMPACT_PATH);
+        return false;
+    }
+
+    // LittleFS renames over an existing file atomically, so a reset here
+    // leaves either the old journal or the new one, never neither.
+    if (!LittleFS.rename(JOURNAL_COMPACT_PATH, JOURNAL_PATH))
+    {
+        LittleFS.remove(JOURNAL_COMPACT_PATH);
+        return false;
+    }
+    journalBytes = expected;
+    return true;
+}
+
+// Sorts out a compaction cut short by a reset. With both files present the
+// rename never happened and the journal is still whole; with only the
+// rewrite present it is the journal.
+static void recoverCompaction()
+{
+    if (!LittleFS.exists(JOURNAL_COMPACT_PATH))
+    {
+        return;
+    }
+    if (LittleFS.exists(JOURNAL_PATH))
+    {
+        LOG_WARN("Discarding unfinished journal compaction");
+        LittleFS.remove(JOURNAL_COMPACT_PATH);
+    }
+    else if (!LittleFS.rename(JOURNAL_COMPACT_PATH, JOURNAL_PATH))
+    {
+        LOG_ERROR("Cannot adopt compacted journal");
+    }
+    else
+    {
+        LOG_INFO("Adopted compacted journal");
+    }
+}
+
+static size_t restoreJournal()
+{
+    journalMounted = LittleFS.begin(true);
+    if (!journalMounted)
+    {
+        LOG_ERROR("LittleFS mount failed, attendance will not survive a reset");
+        return 0;
+    }
+    recoverCompaction();
+
+    size_t applied = 0;
+    bool intact = true;
+    size_t fileBytes = 0;
+    {
+        StoreLock lock;
+        File file = LittleFS.open(JOURNAL_PATH, FILE_READ);
+        if (file)
+        {
+            fileBytes = file.size();
+            applied = replayJournal(file, intact);
+            file.close();
+        }
+        journalBytes = fileBytes;
+
+        if (!intact || fileBytes > JOURNAL_COMPACT_BYTES)
+        {
+            LOG_INFO("Compacting journal (%u bytes%s)", static_cast<unsigned>(fileBytes), intact ? "" : ", torn tail");
+            if (!compactJournal())
+            {
+                LOG_ERROR("Journal compaction failed");
+            }
+        }
+    }
+
+    journalFile = LittleFS.open(JOURNAL_PATH, FILE_APPEND);
+    if (!journalFile)
+    {
+        LOG_ERROR("Cannot open journal for appending");
+        journalMounted = false;
+    }
+
+    LOG_INFO("Journal replayed: %u entries, %u sessions restored",
+             static_cast<unsigned>(applied), static_cast<unsigned>(activeSessionCount()));
+    return applied;
+}
+
+// Once every session is gone the journal holds nothing worth replaying, so
+// start a fresh file instead of letting it grow across lectures. The caller's
+// unlocked check is only a hint; it is repeated under the lock. The file
+// work happens after the lock is released: anything queued from then on
+// belongs to sessions created after the table emptied, and only this task
+// drains the queue, so it lands in the new file.
+static void resetIdleJournal()
+{
+    {
+        StoreLock lock;
+        if (activeSessionCount() != 0 || !journalQueueEmpty())
+        {
+            return;
+        }
+    }
+    journalFile.close();
+    LittleFS.remove(JOURNAL_PATH);
+    journalFile = LittleFS.open(JOURNAL_PATH, FILE_APPEND);
+    journalBytes = 0;
+    LOG_DEBUG("Journal reset, no active sessions");
+}
+
+static void journalFlushLoop(void *)
+{
+    uint32_t reportedDrops = 0;
+    uint8_t chunk[JOURNAL_WRITE_CHUNK];
+
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(JOURNAL_FLUSH_INTERVAL_MS));
+
+        bool wrote = false;
+        while (size_t length = journalTake(chunk, sizeof(chunk)))
+        {
+            journalBytes += journalFile.write(chunk, length);
+            wrote = true;
+        }
+
+        if (wrote)
+        {
+            // One flush per batch keeps flash programming off the per-mark
+            // path and lets LittleFS coalesce the block writes.
+            journalFile.flush();
+        }
+        else if (journalBytes > 0 && activeSessionCount() == 0)
+        {
+            resetIdleJournal();
+        }
+
+        uint32_t dropped = journalDropCount();
+        if (dropped != reportedDrops)
+        {
+            LOG_WARN("Journal queue full, %lu entries lost", static_cast<unsigned long>(dropped - reportedDrops));
+            reportedDrops = dropped;
+        }
+    }
+}
+
+static void journalRestoreTask(void *)
+{
+    restoreJournal();
+    if (journalMounted)
+    {
+        xTaskCreatePinnedToCore(journalFlushLoop, "journal", 4096, nullptr, 1, &journalTask, 1);
+    }
+    journalRestored = true;
+    wakeExpirySweeper();
+    recordBootMilestone(BOOT_RESTORED);
+    vTaskDelete(nullptr);
+}
+
+void startJournalRestore()
+{
+    static bool started = false;
+    if (!started)
+    {
+        started = true;
+        xTaskCreatePinnedToCore(journalRestoreTask, "restore", 6144, nullptr, 1, nullptr, 1);
+    }
+}
+
+bool isJournalRestored()
+{
+    return journalRestored;
+}
@@ -0,0 +1,112 @@
+#include "log.h"
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+static_assert((LOG_BUFFER_BYTES & (LOG_BUFFER_BYTES - 1)) == 0, "LOG_BUFFER_BYTES must be a power of two");
+
+#define LOG_DRAIN_INTERVAL_MS 100
+#define LOG_DRAIN_CHUNK 64
+
+static char logBuffer[LOG_BUFFER_BYTES];
+// Free-running byte counters; head - tail is the number of buffered bytes.
+static uint32_t logHead = 0;
+static uint32_t logTail = 0;
+static uint32_t logDropped = 0;
+static portMUX_TYPE logLock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t logTask = nullptr;
+
+static const char levelTags[] = {'-', 'E', 'W', 'I', 'D'};
+
+static void logDrainTask(void *)
+{
+    uint32_t reportedDrops = 0;
+    char chunk[LOG_DRAIN_CHUNK];
+
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+
+        while (true)
+        {
+            portENTER_CRITICAL(&logLock);
+            uint32_t available = logHead - logTail;
+            uint32_t start = logTail & (LOG_BUFFER_BYTES - 1);
+            uint32_t length = available < LOG_DRAIN_CHUNK ? available : LOG_DRAIN_CHUNK;
+            if (length > LOG_BUFFER_BYTES - start)
+            {
+                length = LOG_BUFFER_BYTES - start;
+            }
+            memcpy(chunk, logBuffer + start, length);
+            logTail += length;
+            uint32_t dropped = logDropped;
+            portEXIT_CRITICAL(&logLock);
+
+            if (length == 0)
+            {
+                if (dropped != reportedDrops)
+                {
+                    Serial.printf("[log] %lu lines dropped\n", static_cast<unsigned long>(dropped - reportedDrops));
+                    reportedDrops = dropped;
+                }
+                break;
+            }
+            Serial.write(reinterpret_cast<const uint8_t *>(chunk), length);
+        }
+    }
+}
+
+void logInit()
+{
+    if (logTask == nullptr)
+    {
+        xTaskCreatePinnedToCore(logDrainTask, "log", 3072, nullptr, 1, &logTask, 1);
+    }
+}
+
+void logWrite(uint8_t level, const char *format, ...)
+{
+    char line[LOG_LINE_MAX];
+    int prefix = snprintf(line, sizeof(line), "[%lu][%c] ", millis(), levelTags[level < sizeof(levelTags) ? level : 0]);
+
+    va_list args;
+    va_start(args, format);
+    int body = vsnprintf(line + prefix, sizeof(line) - prefix, format, args);
+    va_end(args);
+
+    size_t length = prefix + (body < 0 ? 0 : body);
+    if (length > sizeof(line) - 2)
+    {
+        length = sizeof(line) - 2;
+    }
+    line[length++] = '\n';
+
+    portENTER_CRITICAL(&logLock);
+    if (LOG_BUFFER_BYTES - (logHead - logTail) < length)
+    {
+        ++logDropped;
+        portEXIT_CRITICAL(&logLock);
+        return;
+    }
+    uint32_t start = logHead & (LOG_BUFFER_BYTES - 1);
+    size_t first = length < LOG_BUFFER_BYTES - start ? length : LOG_BUFFER_BYTES - start;
+    memcpy(logBuffer + start, line, first);
+    memcpy(logBuffer, line + first, length - first);
+    logHead += length;
+    portEXIT_CRITICAL(&logLock);
+
+    if (logTask != nullptr)
+    {
+        xTaskNotifyGive(logTask);
+    }
+}
+
+uint32_t logDropCount()
+{
+    portENTER_CRITICAL(&logLock);
+    uint32_t dropped = logDropped;
+    portEXIT_CRITICAL(&logLock);
+    return dropped;
+}
@@ -3,347 +3,1097 @@
 #include <NimBLEServer.h>
 #include <NimBLEUtils.h>
 #include <NimBLECharacteristic.h>
-#include <ArduinoJson.h>
-#include <map>
-#include <vector>
 
+#include "boot_metrics.h"
+#include "clock.h"
+#include "connectionless.h"
+#include "connections.h"
+#include "expiry_queue.h"
+#include "export_format.h"
+#include "expiry_sweeper.h"
+#include "gatt_table.h"
+#include "hash.h"
+#include "journal.h"
+#include "json_requests.h"
+#include "json_writer.h"
+#include "log.h"
+#include "metrics.h"
+#include "power_manager.h"
+#include "radio_profile.h"
+#include "session_list_cache.h"
+#include "session_store.h"
+#include "shard_mesh.h"
+#include "store_lock.h"
+#include "store_memory.h"
+#include "wire_format.h"
+#include "write_status.h"
+
+#define DEVICE_NAME "ESP32-Attendance"
 #define SERVICE_UUID "4fafc201-1fb5-459e-8fcc-c5c9c331914b"
 #define CHAR_UUID_CREATE_ATTENDANCE "beb5483e-36e1-4688-b7f5-ea07361b26a8"
 #define CHAR_UUID_MARK_ATTENDANCE "beb5483e-36e1-4688-b7f5-ea07361b26a9"
 #define CHAR_UUID_RETRIEVE_ATTENDANCES "beb5483e-36e1-4688-b7f5-ea07361b26aa"
 #define CHAR_UUID_RETRIEVE_SESSIONS "beb5483f-36e1-4688-b7f5-ea07361b26ab"
+#define CHAR_UUID_ATTENDANCE_PAGE_REQUEST "beb5483e-36e1-4688-b7f5-ea07361b26ac"
+#define CHAR_UUID_ATTENDANCE_PAGE "beb5483e-36e1-4688-b7f5-ea07361b26ad"
+#define CHAR_UUID_MARK_ATTENDANCE_BINARY "beb5483e-36e1-4688-b7f5-ea07361b26ae"
+#define CHAR_UUID_TIME_SYNC "beb5483e-36e1-4688-b7f5-ea07361b26af"
+#define CHAR_UUID_ATTENDANCE_DELTAS "beb5483e-36e1-4688-b7f5-ea07361b26b0"
+#define CHAR_UUID_MARK_ATTENDANCE_BATCH "beb5483e-36e1-4688-b7f5-ea07361b26b1"
+#define CHAR_UUID_WRITE_STATUS "beb5483e-36e1-4688-b7f5-ea07361b26b2"
+#define CHAR_UUID_ATTENDANCE_EXPORT "beb5483e-36e1-4688-b7f5-ea07361b26b3"
+#define CHAR_UUID_METRICS "beb5483e-36e1-4688-b7f5-ea07361b26b4"
 
-#define MAX_SESSIONS 5
+// Time-sync writes before this (2020-01-01) are treated as a phone with no
+// idea what time it is.
+#define MIN_VALID_EPOCH 1577836800UL
 
-NimBLEServer *pServer = nullptr;
-NimBLECharacteristic *pCreateAttendanceCharacteristic = nullptr;
-NimBLECharacteristic *pMarkAttendanceCharacteristic = nullptr;
-NimBLECharacteristic *pRetrieveAttendancesCharacteristic = nullptr;
-NimBLECharacteristic *pRetrieveSessionsCharacteristic = nullptr;
+// Upper bound for one serialized attendance page. Fits in a single ATT read
+// at the 512-byte MTU the app negotiates (MTU minus the 3-byte ATT header).
+// Pages are further capped to the connection's own MTU, so no page needs a
+// long read, whose continuation could see another connection's page.
+#ifndef PAGE_MAX_BYTES
+#define PAGE_MAX_BYTES 500
+#endif
 
-struct AttendanceRecord
-{
-    String name;
-    String matricNumber;
-    unsigned long timestamp;
-};
+// Most records one page can carry: PAGE_MAX_BYTES over the smallest
+// serialized record. Bounds the copy taken under StoreLock.
+#define PAGE_MAX_RECORDS 16
+
+// How often subscribers to the metrics characteristic get a snapshot.
+#ifndef METRICS_NOTIFY_INTERVAL_MS
+#define METRICS_NOTIFY_INTERVAL_MS 10000
+#endif
 
-struct AttendanceSession
+NimBLEServer *pServer = nullptr;
+// Rows of the characteristic table at the bottom of this file, in order.
+enum GattCharacteristic : uint8_t
 {
-    String courseCode;
-    String courseName;
-    unsigned long expiryTimestamp;
+    GATT_CREATE_ATTENDANCE,
+    GATT_MARK_ATTENDANCE,
+    GATT_MARK_ATTENDANCE_BINARY,
+    GATT_MARK_ATTENDANCE_BATCH,
+    GATT_WRITE_STATUS,
+    GATT_TIME_SYNC,
+    GATT_ATTENDANCE_DELTAS,
+    GATT_RETRIEVE_ATTENDANCES,
+    GATT_RETRIEVE_SESSIONS,
+    GATT_ATTENDANCE_PAGE_REQUEST,
+    GATT_ATTENDANCE_PAGE,
+    GATT_ATTENDANCE_EXPORT,
+    GATT_METRICS,
+    GATT_CHARACTERISTIC_COUNT,
 };
 
-std::map<String, AttendanceSession> sessions;
-std::map<String, std::vector<AttendanceRecord>> markedAttendances;
+NimBLECharacteristic *characteristics[GATT_CHARACTERISTIC_COUNT] = {};
 
-void logJson(const JsonDocument& doc, const char* label) {
-    String output;
-    serializeJson(doc, output);
-    Serial.print(label);
-    Serial.println(output);
-}
+// Sequence number of the last attendance delta. Delta notifications carry it
+// so the lecturer's phone can spot a gap and fall back to a full read.
+uint32_t attendanceSequence = 0;
 
-String createResponse(bool success, const String &message)
+#define ATTENDANCE_DELTA_MAX_BYTES (4 + 1 + 1 + SESSION_ID_MAX_LEN + 1 + RECORD_NAME_MAX_LEN + WIRE_MATRIC_BYTES + 4)
+
+// A delta encoded under StoreLock and notified after it is released.
+struct PendingDelta
 {
-    Serial.println("Creating response:");
-    Serial.print("Success: ");
-    Serial.println(success);
-    Serial.print("Message: ");
-    Serial.println(message);
+    uint8_t payload[ATTENDANCE_DELTA_MAX_BYTES];
+    size_t length;
+};
 
-    JsonDocument doc;
-    doc["success"] = success;
-    doc["message"] = message;
-    String response;
-    serializeJson(doc, response);
+// Records the outcome of a write for the status readback and notifies it to
+// the writing connection alone, if it subscribed.
+void reportWriteStatus(ConnectionContext &connection, WriteOperation operation, WriteStatus status)
+{
+    recordWriteOutcome(operation, status);
+    connection.writeStatus[0] = operation;
+    connection.writeStatus[1] = status;
+    if (!connection.statusSubscribed)
+    {
+        return;
+    }
 
-    Serial.print("Response JSON: ");
-    Serial.println(response);
+    os_mbuf *om = ble_hs_mbuf_from_flat(connection.writeStatus, WRITE_STATUS_BYTES);
+    if (om == nullptr || ble_gattc_notify_custom(connection.connHandle,
+                                                 characteristics[GATT_WRITE_STATUS]->getHandle(), om) != 0)
+    {
+        LOG_WARN("Failed to notify write status to connection %u", connection.connHandle);
+    }
+}
 
-    return response;
+// Applies the connection's write rate limit. Returns nullptr if the write
+// should be dropped.
+ConnectionContext *admitWrite(ble_gap_conn_desc *desc, WriteOperation operation)
+{
+    ConnectionContext *connection = findConnection(desc->conn_handle);
+    if (connection == nullptr)
+    {
+        return nullptr;
+    }
+    if (!takeWriteToken(*connection))
+    {
+        LOG_WARN("Dropping write from connection %u: rate limited", desc->conn_handle);
+        reportWriteStatus(*connection, operation, WRITE_STATUS_RATE_LIMITED);
+        return nullptr;
+    }
+    return connection;
 }
 
-void removeExpiredSessions()
+// admitWrite for writes that change the session table, which must wait for
+// the journal replay after a reset.
+ConnectionContext *admitStoreWrite(ble_gap_conn_desc *desc, WriteOperation operation)
 {
-    Serial.println("Checking for expired sessions...");
-    unsigned long currentTime = millis();
-    for (auto it = sessions.begin(); it != sessions.end();)
+    ConnectionContext *connection = admitWrite(desc, operation);
+    if (connection != nullptr && !isJournalRestored())
     {
-        Serial.print("Checking session: ");
-        Serial.println(it->first);
-        Serial.print("Current time: ");
-        Serial.print(currentTime);
-        Serial.print(", Expiry time: ");
-        Serial.println(it->second.expiryTimestamp);
+        reportWriteStatus(*connection, operation, WRITE_STATUS_RESTORING);
+        return nullptr;
+    }
+    return connection;
+}
 
-        if (it->second.expiryTimestamp <= currentTime)
-        {
-            Serial.print("Removing expired session: ");
-            Serial.println(it->first);
-            markedAttendances.erase(it->first);
-            it = sessions.erase(it);
-        }
-        else
-        {
-            ++it;
-        }
+// Keeps a lecturer device connected and moves it to the bulk-transfer
+// radio profile.
+void holdLecturerConnection(ConnectionContext &connection)
+{
+    if (markPersistent(connection))
+    {
+        applyRadioProfile(pServer, connection.connHandle, RADIO_PROFILE_BURST_SYNC);
     }
-    Serial.print("Remaining active sessions: ");
-    Serial.println(sessions.size());
 }
 
 class ServerCallbacks : public NimBLEServerCallbacks
 {
-    void onConnect(NimBLEServer *pServer)
+    void onConnect(NimBLEServer *pServer, ble_gap_conn_desc *desc)
     {
-        Serial.println("Client connected");
-        pServer->startAdvertising();
-        Serial.println("Restarted advertising");
+        openConnection(desc->conn_handle);
+        // Every central starts as a student; lecturer actions upgrade it.
+        applyRadioProfile(pServer, desc->conn_handle, RADIO_PROFILE_MANY_STUDENTS);
+        LOG_INFO("Client connected (%u), %u connected",
+                 desc->conn_handle, static_cast<unsigned>(connectionCount()));
+
+        // Keep accepting centrals until every connection slot is taken.
+        if (connectionCount() < MAX_CONNECTIONS)
+        {
+            pServer->startAdvertising();
+            LOG_DEBUG("Restarted advertising");
+        }
     };
 
-    void onDisconnect(NimBLEServer *pServer)
+    void onDisconnect(NimBLEServer *pServer, ble_gap_conn_desc *desc)
     {
-        Serial.println("Client disconnected");
+        closeConnection(desc->conn_handle);
+        LOG_INFO("Client disconnected (%u)", desc->conn_handle);
         pServer->startAdvertising();
-        Serial.println("Restarted advertising");
+        LOG_DEBUG("Restarted advertising");
+    }
+
+    void onMTUChange(uint16_t MTU, ble_gap_conn_desc *desc)
+    {
+        ConnectionContext *connection = findConnection(desc->conn_handle);
+        if (connection != nullptr)
+        {
+            connection->mtu = MTU;
+        }
+        LOG_DEBUG("MTU for connection %u is now %u", desc->conn_handle, MTU);
     }
 };
 
-class CreateAttendanceCallback : public NimBLECharacteristicCallbacks
+void onCreateAttendanceWrite(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc)
 {
-    void onWrite(NimBLECharacteristic *pCharacteristic)
+    ConnectionContext *connection = admitStoreWrite(desc, WRITE_OP_CREATE_SESSION);
+    if (connection == nullptr)
     {
-        Serial.println("CreateAttendanceCallback: onWrite called");
-        std::string value = pCharacteristic->getValue();
-        Serial.print("Received value: ");
-        Serial.println(value.c_str());
+        return;
+    }
+    holdLecturerConnection(*connection);
 
-        JsonDocument doc;
-        DeserializationError error = deserializeJson(doc, value);
+    std::string value = pCharacteristic->getValue();
+    LOG_DEBUG("Received value: %s", value.c_str());
 
-        if (error)
+    CreateSessionRequest request;
+    WriteStatus decoded = decodeCreateSessionRequest(value.data(), value.length(), request);
+    if (decoded != WRITE_STATUS_OK)
+    {
+        LOG_WARN("%s", decoded == WRITE_STATUS_MALFORMED ? "Failed to parse JSON" : "Session ID is empty or too long");
+        reportWriteStatus(*connection, WRITE_OP_CREATE_SESSION, decoded);
+        return;
+    }
+    const char *sessionId = request.sessionId;
+    size_t sessionIdLength = request.sessionIdLength;
+    unsigned long expiryTimestamp = request.expiryTimestamp;
+
+    LOG_DEBUG("Session ID: %s, course: %s %s, expiry timestamp: %lu",
+              sessionId, request.courseCode, request.courseName, expiryTimestamp);
+
+    // The status is reported once the lock is released, since reporting it
+    // notifies.
+    bool claimed = false;
+    {
+        StoreLock lock;
+        SessionSlot *slot = claimSession(sessionId, sessionIdLength);
+        if (slot != nullptr)
         {
-            Serial.print("Failed to parse JSON: ");
-            Serial.println(error.c_str());
-            return;
+            copyField(slot->session.courseCode, sizeof(slot->session.courseCode), request.courseCode,
+                      strlen(request.courseCode));
+            copyField(slot->session.courseName, sizeof(slot->session.courseName), request.courseName,
+                      strlen(request.courseName));
+            slot->session.expiryTimestamp = expiryTimestamp;
+            scheduleExpiry(sessionIndex(slot), expiryTimestamp);
+            touchSessionTable();
+            journalSession(*slot);
+            shardPublishSession(*slot);
+            claimed = true;
         }
+    }
+    if (!claimed)
+    {
+        LOG_WARN("Maximum number of sessions reached");
+        reportWriteStatus(*connection, WRITE_OP_CREATE_SESSION, WRITE_STATUS_SESSIONS_FULL);
+        return;
+    }
+    wakeExpirySweeper();
+    notePowerActivity();
+
+    LOG_INFO("Attendance session %s created, %u active",
+             sessionId, static_cast<unsigned>(activeSessionCount()));
+    reportWriteStatus(*connection, WRITE_OP_CREATE_SESSION, WRITE_STATUS_OK);
+}
+
+// Encodes a newly accepted record for subscribed lecturer devices. The
+// caller holds StoreLock, which orders the sequence numbers, and sends the
+// delta with sendAttendanceDelta once it has released the lock.
+void queueAttendanceDelta(const SessionSlot &slot, const AttendanceRecord &record, PendingDelta &pending)
+{
+    ++attendanceSequence;
+    pending.length = 0;
+    if (characteristics[GATT_ATTENDANCE_DELTAS]->getSubscribedCount() == 0)
+    {
+        return;
+    }
 
-        logJson(doc, "Parsed JSON: ");
+    MarkAttendanceMessage delta;
+    delta.sessionId = {slot.sessionId, slot.idLength};
+    delta.name = makeWireString(record.name);
+    delta.matricNumber = makeWireString(record.matricNumber);
+    delta.timestamp = record.timestamp;
 
-        String sessionId = doc["sessionId"].as<String>();
-        String courseCode = doc["courseCode"].as<String>();
-        String courseName = doc["courseName"].as<String>();
-        unsigned long expiryTimestamp = doc["expiryTimestamp"].as<unsigned long>();
+    pending.length = encodeAttendanceDelta(attendanceSequence, delta, pending.payload, sizeof(pending.payload));
+}
 
-        Serial.print("Session ID: ");
-        Serial.println(sessionId);
-        Serial.print("Course Code: ");
-        Serial.println(courseCode);
-        Serial.print("Course Name: ");
-        Serial.println(courseName);
-        Serial.print("Expiry Timestamp: ");
-        Serial.println(expiryTimestamp);
+void sendAttendanceDelta(const PendingDelta &pending)
+{
+    if (pending.length > 0)
+    {
+        characteristics[GATT_ATTENDANCE_DELTAS]->notify(pending.payload, pending.length);
+    }
+}
+
+// Picks the timestamp a record is stamped with. Once the lecturer's phone
+// has synced the clock, records are stamped and checked against it. Until
+// then the client's timestamp is used and the first one anchors the clock so
+// the sweeper can start evicting.
+uint32_t markTimestamp(uint32_t clientTimestamp)
+{
+    uint32_t timestamp = clientTimestamp;
+    if (isClockSynced())
+    {
+        currentEpoch(timestamp);
+    }
+    else if (observeEpoch(clientTimestamp))
+    {
+        wakeExpirySweeper();
+    }
+    return timestamp;
+}
+
+// Adds one student to a session. The caller holds StoreLock and sends the
+// queued delta after releasing it; it is left empty unless the mark is added.
+WriteStatus markInSession(SessionSlot &slot, const MarkAttendanceMessage &message, uint32_t timestamp,
+                          PendingDelta &pending)
+{
+    pending.length = 0;
+    if (message.matricNumber.length == 0 || message.matricNumber.length > RECORD_MATRIC_MAX_LEN)
+    {
+        LOG_WARN("Invalid matric number");
+        return WRITE_STATUS_INVALID_FIELD;
+    }
 
-        if (sessions.size() >= MAX_SESSIONS)
+    if (timestamp > slot.session.expiryTimestamp)
+    {
+        LOG_WARN("Attendance session %s has expired", slot.sessionId);
+        return WRITE_STATUS_EXPIRED;
+    }
+
+    AttendanceRecord *record = nullptr;
+    AddAttendanceResult result = addAttendance(slot, message.name.data, message.name.length,
+                                               message.matricNumber.data, message.matricNumber.length,
+                                               timestamp, record);
+    if (result == ATTENDANCE_DUPLICATE)
+    {
+        LOG_DEBUG("Attendance already marked for this matric number");
+        return WRITE_STATUS_DUPLICATE;
+    }
+    if (result == ATTENDANCE_NO_STORAGE)
+    {
+        LOG_WARN("No record storage left for session %s", slot.sessionId);
+        return WRITE_STATUS_STORAGE_FULL;
+    }
+
+    LOG_INFO("Attendance marked for %s, %u in session",
+             record->matricNumber, static_cast<unsigned>(slot.attendances.count));
+
+    journalMark(slot, *record);
+    shardPublishMark(slot, *record);
+    queueAttendanceDelta(slot, *record, pending);
+    notePowerActivity();
+    return WRITE_STATUS_OK;
+}
+
+// Shared by the JSON and binary mark-attendance characteristics.
+WriteStatus acceptAttendance(const MarkAttendanceMessage &message)
+{
+    uint32_t timestamp = markTimestamp(message.timestamp);
+
+    LOG_DEBUG("Session ID: %.*s, student: %.*s (%.*s), timestamp: %lu",
+              message.sessionId.length, message.sessionId.data,
+              message.name.length, message.name.data,
+              message.matricNumber.length, message.matricNumber.data,
+              static_cast<unsigned long>(message.timestamp));
+
+    PendingDelta pending;
+    WriteStatus status;
+    {
+        StoreLock lock;
+        SessionSlot *slot = findSession(message.sessionId.data, message.sessionId.length);
+        if (slot == nullptr)
         {
-            Serial.println("Maximum number of sessions reached");
-            return;
+            LOG_WARN("No active attendance session found for this ID");
+            return WRITE_STATUS_UNKNOWN_SESSION;
         }
+        status = markInSession(*slot, message, timestamp, pending);
+    }
+    sendAttendanceDelta(pending);
+    return status;
+}
 
-        AttendanceSession newSession = {courseCode, courseName, expiryTimestamp};
-        sessions[sessionId] = newSession;
+// Applies a session or mark another shard took, as if it were taken here but
+// without publishing it again. A mark this beacon already holds is dropped
+// by the dedup index, which is what merges the shards' lists.
+ShardApplyResult applyShardEntry(const JournalEntry &entry)
+{
+    if (entry.type == JOURNAL_SESSION)
+    {
+        JournalSession session;
+        if (!decodeJournalSession(entry, session))
+        {
+            return SHARD_APPLIED;
+        }
+        {
+            StoreLock lock;
+            SessionSlot *slot = claimSession(session.sessionId.data, session.sessionId.length);
+            if (slot == nullptr)
+            {
+                LOG_WARN("No slot for shard session %.*s", session.sessionId.length, session.sessionId.data);
+                return SHARD_APPLIED;
+            }
+            copyField(slot->session.courseCode, sizeof(slot->session.courseCode), session.courseCode.data,
+                      session.courseCode.length);
+            copyField(slot->session.courseName, sizeof(slot->session.courseName), session.courseName.data,
+                      session.courseName.length);
+            slot->session.expiryTimestamp = session.expiryTimestamp;
+            scheduleExpiry(sessionIndex(slot), session.expiryTimestamp);
+            touchSessionTable();
+            journalSession(*slot);
+        }
+        wakeExpirySweeper();
+        notePowerActivity();
+        return SHARD_APPLIED;
+    }
 
-        Serial.println("New attendance session created successfully");
-        Serial.print("Total active sessions: ");
-        Serial.println(sessions.size());
+    MarkAttendanceMessage mark;
+    if (entry.type != JOURNAL_MARK || !decodeJournalMark(entry, mark) || mark.matricNumber.length == 0 ||
+        mark.matricNumber.length > RECORD_MATRIC_MAX_LEN)
+    {
+        return SHARD_APPLIED;
+    }
+    PendingDelta pending;
+    pending.length = 0;
+    {
+        StoreLock lock;
+        SessionSlot *slot = findSession(mark.sessionId.data, mark.sessionId.length);
+        if (slot == nullptr)
+        {
+            // Its session entry may still be on the way from a third shard.
+            return SHARD_RETRY;
+        }
+        AttendanceRecord *record = nullptr;
+        if (addAttendance(*slot, mark.name.data, mark.name.length, mark.matricNumber.data, mark.matricNumber.length,
+                          mark.timestamp, record) == ATTENDANCE_ADDED)
+        {
+            journalMark(*slot, *record);
+            queueAttendanceDelta(*slot, *record, pending);
+            notePowerActivity();
+        }
+    }
+    sendAttendanceDelta(pending);
+    return SHARD_APPLIED;
+}
+
+// Marks collected by scanning have no connection to report to.
+WriteStatus acceptConnectionlessMark(const MarkAttendanceMessage &message)
+{
+    WriteStatus status = acceptAttendance(message);
+    recordWriteOutcome(WRITE_OP_MARK, status);
+    return status;
+}
+
+void onMarkAttendanceWrite(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc)
+{
+    ConnectionContext *connection = admitStoreWrite(desc, WRITE_OP_MARK);
+    if (connection == nullptr)
+    {
+        return;
+    }
+
+    std::string value = pCharacteristic->getValue();
+    LOG_DEBUG("Received value: %s", value.c_str());
+
+    MarkRequest request;
+    if (!decodeMarkRequest(value.data(), value.length(), request))
+    {
+        LOG_WARN("Failed to parse JSON");
+        reportWriteStatus(*connection, WRITE_OP_MARK, WRITE_STATUS_MALFORMED);
+        return;
+    }
+
+    WriteStatus status = acceptAttendance(markMessage(request));
+    reportWriteStatus(*connection, WRITE_OP_MARK, status);
+    if (isWriteAccepted(status))
+    {
+        scheduleDisconnectAfterMark(*connection);
+    }
+}
+
+void onMarkAttendanceBinaryWrite(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc)
+{
+    ConnectionContext *connection = admitStoreWrite(desc, WRITE_OP_MARK);
+    if (connection == nullptr)
+    {
+        return;
     }
-};
 
-class MarkAttendanceCallback : public NimBLECharacteristicCallbacks
+    NimBLEAttValue value = pCharacteristic->getValue();
+
+    MarkAttendanceMessage message;
+    if (!decodeMarkAttendance(value.data(), value.length(), message))
+    {
+        LOG_WARN("Failed to decode binary mark-attendance record");
+        reportWriteStatus(*connection, WRITE_OP_MARK, WRITE_STATUS_MALFORMED);
+        return;
+    }
+
+    WriteStatus status = acceptAttendance(message);
+    reportWriteStatus(*connection, WRITE_OP_MARK, status);
+    if (isWriteAccepted(status))
+    {
+        scheduleDisconnectAfterMark(*connection);
+    }
+}
+
+// Applies a whole batch under one session lookup. The per-record status is
+// kept on the connection and returned by the next read. Batches come from
+// proxy marking and offline replays, so the connection is left up for the
+// readback and further batches.
+void onMarkAttendanceBatchWrite(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc)
 {
-    void onWrite(NimBLECharacteristic *pCharacteristic)
+    ConnectionContext *connection = admitStoreWrite(desc, WRITE_OP_MARK_BATCH);
+    if (connection == nullptr)
     {
-        Serial.println("MarkAttendanceCallback: onWrite called");
-        std::string value = pCharacteristic->getValue();
-        Serial.print("Received value: ");
-        Serial.println(value.c_str());
+        return;
+    }
+
+    NimBLEAttValue value = pCharacteristic->getValue();
 
-        JsonDocument doc;
-        DeserializationError error = deserializeJson(doc, value);
+    uint8_t *status = connection->batchStatus;
+    memset(status, 0, WIRE_BATCH_STATUS_BYTES);
 
-        if (error)
+    MarkBatch batch;
+    if (!decodeMarkBatch(value.data(), value.length(), batch))
+    {
+        LOG_WARN("Failed to decode mark-attendance batch");
+        reportWriteStatus(*connection, WRITE_OP_MARK_BATCH, WRITE_STATUS_MALFORMED);
+        return;
+    }
+    status[0] = batch.count;
+
+    // Timestamps are picked before taking the lock, since the first one may
+    // wake the sweeper.
+    uint32_t timestamps[WIRE_BATCH_MAX_RECORDS];
+    {
+        size_t pos = 0;
+        MarkAttendanceMessage message;
+        for (uint8_t i = 0; i < batch.count && nextBatchRecord(batch, pos, message); ++i)
         {
-            Serial.print("Failed to parse JSON: ");
-            Serial.println(error.c_str());
-            return;
+            timestamps[i] = markTimestamp(message.timestamp);
         }
+    }
+
+    // The deltas and the status are sent once the lock is released, since
+    // both notify. Per-record outcomes are in the bitmap; the status only
+    // says whether the batch itself was applied. Only the host task writes
+    // batches, so the deltas can share one buffer.
+    static PendingDelta deltas[WIRE_BATCH_MAX_RECORDS];
+    size_t deltaCount = 0;
+    WriteStatus batchStatus = WRITE_STATUS_OK;
+    {
+        StoreLock lock;
+        SessionSlot *slot = findSession(batch.sessionId.data, batch.sessionId.length);
+        if (slot == nullptr)
+        {
+            LOG_WARN("No active attendance session found for this ID");
+            batchStatus = WRITE_STATUS_UNKNOWN_SESSION;
+        }
+        else
+        {
+            size_t accepted = 0;
+            size_t pos = 0;
+            MarkAttendanceMessage message;
+            for (uint8_t i = 0; i < batch.count && nextBatchRecord(batch, pos, message); ++i)
+            {
+                WriteStatus recordStatus = markInSession(*slot, message, timestamps[i], deltas[deltaCount]);
+                recordWriteOutcome(WRITE_OP_MARK, recordStatus);
+                if (deltas[deltaCount].length > 0)
+                {
+                    ++deltaCount;
+                }
+                if (isWriteAccepted(recordStatus))
+                {
+                    status[1 + i / 8] |= static_cast<uint8_t>(1u << (i % 8));
+                    ++accepted;
+                }
+            }
+
+            LOG_INFO("Batch of %u marks for %s, %u on the list",
+                     batch.count, slot->sessionId, static_cast<unsigned>(accepted));
+        }
+    }
+    for (size_t i = 0; i < deltaCount; ++i)
+    {
+        sendAttendanceDelta(deltas[i]);
+    }
+    reportWriteStatus(*connection, WRITE_OP_MARK_BATCH, batchStatus);
+}
+
+void onMarkAttendanceBatchRead(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc)
+{
+    ConnectionContext *connection = findConnection(desc->conn_handle);
+    if (connection == nullptr)
+    {
+        return;
+    }
+    touchConnection(*connection);
+    const uint8_t *status = connection->batchStatus;
+    pCharacteristic->setValue(status, 1 + (status[0] + 7) / 8);
+}
+
+void onWriteStatusRead(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc)
+{
+    ConnectionContext *connection = findConnection(desc->conn_handle);
+    if (connection == nullptr)
+    {
+        return;
+    }
+    pCharacteristic->setValue(connection->writeStatus, WRITE_STATUS_BYTES);
+}
+
+void onWriteStatusSubscribe(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc, uint16_t subValue)
+{
+    ConnectionContext *connection = findConnection(desc->conn_handle);
+    if (connection != nullptr)
+    {
+        connection->statusSubscribed = (subValue & 0x0001) != 0;
+    }
+}
+
+void onTimeSyncWrite(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc)
+{
+    ConnectionContext *connection = admitWrite(desc, WRITE_OP_TIME_SYNC);
+    if (connection == nullptr)
+    {
+        return;
+    }
+    holdLecturerConnection(*connection);
 
-        logJson(doc, "Parsed JSON: ");
+    NimBLEAttValue value = pCharacteristic->getValue();
 
-        String sessionId = doc["sessionId"].as<String>();
-        String studentName = doc["name"].as<String>();
-        String matricNumber = doc["matricNumber"].as<String>();
-        unsigned long timestamp = doc["timestamp"].as<unsigned long>();
+    uint32_t epochSeconds = 0;
+    if (!decodeTimeSync(value.data(), value.length(), epochSeconds))
+    {
+        LOG_WARN("Failed to parse time sync");
+        reportWriteStatus(*connection, WRITE_OP_TIME_SYNC, WRITE_STATUS_MALFORMED);
+        return;
+    }
+
+    if (epochSeconds < MIN_VALID_EPOCH)
+    {
+        LOG_WARN("Ignoring implausible time sync: %lu", static_cast<unsigned long>(epochSeconds));
+        reportWriteStatus(*connection, WRITE_OP_TIME_SYNC, WRITE_STATUS_INVALID_FIELD);
+        return;
+    }
 
-        Serial.print("Session ID: ");
-        Serial.println(sessionId);
-        Serial.print("Student Name: ");
-        Serial.println(studentName);
-        Serial.print("Matric Number: ");
-        Serial.println(matricNumber);
-        Serial.print("Timestamp: ");
-        Serial.println(timestamp);
+    syncEpoch(epochSeconds);
+    wakeExpirySweeper();
+    LOG_INFO("Clock synced to %lu", static_cast<unsigned long>(epochSeconds));
+    reportWriteStatus(*connection, WRITE_OP_TIME_SYNC, WRITE_STATUS_OK);
+}
+
+// One record as the retrieve and page reads serialize it.
+void writeRecordJson(JsonWriter &writer, const AttendanceRecord &record)
+{
+    writer.beginObject();
+    writer.key("seq");
+    writer.value(static_cast<unsigned long>(record.sequence));
+    writer.key("name");
+    writer.value(record.name);
+    writer.key("matricNumber");
+    writer.value(record.matricNumber);
+    writer.key("timestamp");
+    writer.value(static_cast<unsigned long>(record.timestamp));
+    writer.endObject();
+}
+
+size_t decimalDigits(size_t value)
+{
+    size_t digits = 1;
+    while (value >= 10)
+    {
+        value /= 10;
+        ++digits;
+    }
+    return digits;
+}
+
+void onRetrieveAttendancesRead(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc)
+{
+    ConnectionContext *connection = findConnection(desc->conn_handle);
+    if (connection != nullptr)
+    {
+        holdLecturerConnection(*connection);
+    }
 
-        if (sessions.find(sessionId) != sessions.end())
+    // Streamed straight from the session table into one attribute's
+    // worth of buffer. Whatever does not fit is left off at a record
+    // boundary; paged and export reads have the complete list.
+    static char attendancesJson[BLE_ATT_ATTR_MAX_LEN];
+    JsonWriter writer(attendancesJson, sizeof(attendancesJson));
+    bool truncated = false;
+    {
+        StoreLock lock;
+        writer.beginObject();
+        for (const SessionSlot &slot : sessionSlots())
         {
-            AttendanceSession &session = sessions[sessionId];
-            Serial.print("Session found. Expiry timestamp: ");
-            Serial.println(session.expiryTimestamp);
+            if (!slot.inUse || truncated)
+            {
+                continue;
+            }
 
-            if (timestamp <= session.expiryTimestamp)
+            JsonWriter::Mark sessionMark = writer.mark();
+            writer.key(slot.sessionId);
+            writer.beginObject();
+            writer.key("sessionId");
+            writer.value(slot.sessionId, slot.idLength);
+            writer.key("courseCode");
+            writer.value(slot.session.courseCode);
+            writer.key("courseName");
+            writer.value(slot.session.courseName);
+            writer.key("expiryTimestamp");
+            writer.value(slot.session.expiryTimestamp);
+            writer.key("attendances");
+            writer.beginArray();
+            if (writer.full())
             {
-                AttendanceRecord record = {studentName, matricNumber, timestamp};
-                markedAttendances[sessionId].push_back(record);
-                Serial.println("Attendance marked successfully");
-                Serial.print("Total attendances for this session: ");
-                Serial.println(markedAttendances[sessionId].size());
+                writer.rewind(sessionMark);
+                truncated = true;
+                continue;
             }
-            else
+
+            RecordCursor cursor = recordCursorAt(slot.attendances, 0);
+            while (const AttendanceRecord *record = nextRecord(slot.attendances, cursor))
             {
-                Serial.println("Attendance session has expired");
+                JsonWriter::Mark recordMark = writer.mark();
+                writeRecordJson(writer, *record);
+                if (writer.full())
+                {
+                    writer.rewind(recordMark);
+                    truncated = true;
+                    break;
+                }
             }
+            writer.endArray();
+            writer.endObject();
         }
-        else
+        writer.endObject();
+    }
+
+    if (truncated)
+    {
+        LOG_WARN("Attendance list truncated to %u bytes", static_cast<unsigned>(writer.length()));
+    }
+    LOG_DEBUG("Retrieved attendances: %u bytes", static_cast<unsigned>(writer.length()));
+
+    pCharacteristic->setValue(reinterpret_cast<const uint8_t *>(attendancesJson), writer.length());
+}
+
+void onAttendancePageRequestWrite(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc)
+{
+    ConnectionContext *connection = admitWrite(desc, WRITE_OP_PAGE_REQUEST);
+    if (connection == nullptr)
+    {
+        return;
+    }
+    holdLecturerConnection(*connection);
+    PageCursor &pageCursor = connection->page;
+
+    std::string value = pCharacteristic->getValue();
+
+    PageRequest request;
+    if (!decodePageRequest(value.data(), value.length(), request))
+    {
+        LOG_WARN("Failed to parse JSON");
+        reportWriteStatus(*connection, WRITE_OP_PAGE_REQUEST, WRITE_STATUS_MALFORMED);
+        return;
+    }
+    memcpy(pageCursor.sessionId, request.sessionId, sizeof(pageCursor.sessionId));
+    pageCursor.offset = request.offset;
+
+    LOG_DEBUG("Page cursor set to %s @ %u", pageCursor.sessionId, static_cast<unsigned>(pageCursor.offset));
+    reportWriteStatus(*connection, WRITE_OP_PAGE_REQUEST, WRITE_STATUS_OK);
+}
+
+// Copies up to capacity records from the cursor's position under the lock,
+// so the caller can serialize them after releasing it and a page read never
+// holds up a mark. Sets total to the session's record count and offset to
+// the clamped cursor position.
+size_t copyPageRecords(const PageCursor &pageCursor, AttendanceRecord *records, size_t capacity,
+                       size_t &total, size_t &offset)
+{
+    StoreLock lock;
+    const SessionSlot *slot = findSession(pageCursor.sessionId, strlen(pageCursor.sessionId));
+    total = slot != nullptr ? slot->attendances.count : 0;
+    offset = pageCursor.offset < total ? pageCursor.offset : total;
+    if (slot == nullptr)
+    {
+        return 0;
+    }
+
+    size_t copied = 0;
+    RecordCursor cursor = recordCursorAt(slot->attendances, offset);
+    while (copied < capacity)
+    {
+        const AttendanceRecord *record = nextRecord(slot->attendances, cursor);
+        if (record == nullptr)
         {
-            Serial.println("No active attendance session found for this ID");
+            break;
         }
+        records[copied++] = *record;
     }
-};
+    return copied;
+}
 
-class RetrieveAttendancesCallback : public NimBLECharacteristicCallbacks
+// Serializes as many of the copied records as fit in capacity and sets next
+// past the last one. Returns 0 if not even the header and one record fit.
+size_t writePageJson(char *out, size_t capacity, const PageCursor &pageCursor, const AttendanceRecord *records,
+                     size_t copied, size_t offset, size_t total, size_t &next)
 {
-    void onRead(NimBLECharacteristic *pCharacteristic)
-    {
-        Serial.println("RetrieveAttendancesCallback: onRead called");
+    JsonWriter writer(out, capacity);
+    writer.beginObject();
+    writer.key("sessionId");
+    writer.value(pageCursor.sessionId);
+    writer.key("cursor");
+    writer.value(static_cast<unsigned long>(pageCursor.offset));
+    writer.key("total");
+    writer.value(static_cast<unsigned long>(total));
 
-        JsonDocument doc;
-        JsonObject sessionsObj = doc.to<JsonObject>();
+    // "next" goes last and never has more digits than "total".
+    size_t nextBytes = strlen(",\"next\":") + decimalDigits(total);
+    writer.reserve(nextBytes);
+    writer.key("attendances");
+    writer.beginArray();
+    if (writer.full())
+    {
+        return 0;
+    }
 
-        for (const auto &pair : sessions)
+    next = offset;
+    for (size_t i = 0; i < copied; ++i)
+    {
+        JsonWriter::Mark mark = writer.mark();
+        writeRecordJson(writer, records[i]);
+        if (writer.full())
         {
-            JsonObject sessionObj = sessionsObj[pair.first].to<JsonObject>();
-            sessionObj["sessionId"] = pair.first;
-            sessionObj["courseCode"] = pair.second.courseCode;
-            sessionObj["courseName"] = pair.second.courseName;
-            sessionObj["expiryTimestamp"] = pair.second.expiryTimestamp;
-
-            JsonArray attendancesArray = sessionObj["attendances"].to<JsonArray>();
-            const auto &sessionAttendances = markedAttendances[pair.first];
-            for (const auto &record : sessionAttendances)
+            if (i == 0)
             {
-                JsonObject recordObj = attendancesArray.add<JsonObject>();
-                recordObj["name"] = record.name;
-                recordObj["matricNumber"] = record.matricNumber;
-                recordObj["timestamp"] = record.timestamp;
+                return 0;
             }
+            writer.rewind(mark);
+            break;
         }
+        ++next;
+    }
+    writer.endArray();
+    writer.release(nextBytes);
+    writer.key("next");
+    writer.value(static_cast<unsigned long>(next));
+    writer.endObject();
+    return writer.length();
+}
 
-        String attendancesJson;
-        serializeJson(doc, attendancesJson);
+void onAttendancePageRead(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc)
+{
+    ConnectionContext *connection = findConnection(desc->conn_handle);
+    if (connection == nullptr)
+    {
+        return;
+    }
+    touchConnection(*connection);
+    PageCursor &pageCursor = connection->page;
+    size_t pageBudget = connection->mtu - 3 < PAGE_MAX_BYTES ? connection->mtu - 3 : PAGE_MAX_BYTES;
 
-        Serial.println("Retrieved attendances:");
-        Serial.println(attendancesJson);
+    // Static to keep it off the host task's stack; only that task reads pages.
+    static AttendanceRecord records[PAGE_MAX_RECORDS];
+    size_t total = 0;
+    size_t offset = 0;
+    size_t copied = copyPageRecords(pageCursor, records, PAGE_MAX_RECORDS, total, offset);
 
-        pCharacteristic->setValue(attendancesJson);
+    static char pageJson[PAGE_MAX_BYTES];
+    size_t next = offset;
+    size_t length = writePageJson(pageJson, pageBudget, pageCursor, records, copied, offset, total, next);
+    if (length == 0)
+    {
+        // Always ship at least one record so the cursor keeps moving,
+        // even if it takes a long read at a small MTU.
+        length = writePageJson(pageJson, sizeof(pageJson), pageCursor, records, copied, offset, total, next);
     }
-};
+    pageCursor.offset = next;
 
-class RetrieveSessionsCallback : public NimBLECharacteristicCallbacks
+    LOG_DEBUG("Serving page of %u records, next cursor: %u",
+              static_cast<unsigned>(next - offset), static_cast<unsigned>(next));
+
+    pCharacteristic->setValue(reinterpret_cast<const uint8_t *>(pageJson), length);
+}
+
+// Same cursor as the JSON page, but each read returns a columnar block;
+// see export_format.h. An empty block (count 0) marks the end.
+void onAttendanceExportRead(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc)
 {
-    void onRead(NimBLECharacteristic *pCharacteristic)
+    ConnectionContext *connection = findConnection(desc->conn_handle);
+    if (connection == nullptr)
     {
-        Serial.println("RetrieveSessionsCallback: onRead called");
+        return;
+    }
+    touchConnection(*connection);
+    PageCursor &pageCursor = connection->page;
+    size_t pageBudget = connection->mtu - 3 < PAGE_MAX_BYTES ? connection->mtu - 3 : PAGE_MAX_BYTES;
 
-        JsonDocument doc;
-        JsonArray sessionsArray = doc.to<JsonArray>();
+    static AttendanceRecord records[EXPORT_MAX_RECORDS];
+    static uint8_t block[PAGE_MAX_BYTES];
+    size_t total = 0;
+    size_t offset = 0;
+    size_t copied = copyPageRecords(pageCursor, records, EXPORT_MAX_RECORDS, total, offset);
 
-        for (const auto &pair : sessions)
-        {
-            JsonObject sessionObj = sessionsArray.add<JsonObject>();
-            sessionObj["sessionId"] = pair.first;
-            sessionObj["courseCode"] = pair.second.courseCode;
-            sessionObj["courseName"] = pair.second.courseName;
-            sessionObj["expiryTimestamp"] = pair.second.expiryTimestamp;
-        }
+    uint32_t sessionTag = fnv1a(pageCursor.sessionId, strlen(pageCursor.sessionId));
+    size_t count = 0;
+    size_t length = encodeExportBlock(sessionTag, records, copied, offset, total, block, pageBudget, count);
+    if (length == 0)
+    {
+        // Too small an MTU for even one record: ship it anyway so the
+        // cursor keeps moving, and let the client use a long read.
+        length = encodeExportBlock(sessionTag, records, copied, offset, total, block, sizeof(block), count);
+    }
+    pageCursor.offset = offset + count;
+
+    LOG_DEBUG("Serving export block of %u records in %u bytes, next cursor: %u",
+              static_cast<unsigned>(count), static_cast<unsigned>(length),
+              static_cast<unsigned>(pageCursor.offset));
+
+    pCharacteristic->setValue(block, length);
+}
+
+void onAttendanceDeltasSubscribe(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc, uint16_t subValue)
+{
+    ConnectionContext *connection = findConnection(desc->conn_handle);
+    if (connection != nullptr && subValue != 0)
+    {
+        holdLecturerConnection(*connection);
+    }
+}
+
+void onMetricsRead(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc)
+{
+    uint8_t snapshot[METRICS_MAX_BYTES];
+    pCharacteristic->setValue(snapshot, encodeMetrics(snapshot, sizeof(snapshot)));
+}
+
+// Pushes a snapshot to metrics subscribers every METRICS_NOTIFY_INTERVAL_MS.
+// Notifications are cut to each connection's MTU, so collectors should
+// negotiate a large one or read instead.
+void notifyMetrics()
+{
+    static uint64_t lastNotifyMillis = 0;
+    uint64_t now = monotonicMillis();
+    if (now - lastNotifyMillis < METRICS_NOTIFY_INTERVAL_MS || characteristics[GATT_METRICS]->getSubscribedCount() == 0)
+    {
+        return;
+    }
+    lastNotifyMillis = now;
+
+    uint8_t snapshot[METRICS_MAX_BYTES];
+    characteristics[GATT_METRICS]->notify(snapshot, encodeMetrics(snapshot, sizeof(snapshot)));
+}
+
+void onRetrieveSessionsRead(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc)
+{
+    // Generation of the session list last copied into the characteristic.
+    // While it is current the read is served from the stored value as is.
+    static uint32_t servedGeneration = 0;
+    static bool served = false;
 
-        String sessionsJson;
-        serializeJson(doc, sessionsJson);
+    ConnectionContext *connection = findConnection(desc->conn_handle);
+    if (connection != nullptr)
+    {
+        touchConnection(*connection);
+    }
 
-        Serial.println("Retrieved sessions:");
-        Serial.println(sessionsJson);
+    if (served && servedGeneration == sessionTableGeneration.load(std::memory_order_acquire))
+    {
+        return;
+    }
 
-        pCharacteristic->setValue(sessionsJson);
+    SessionListJson sessions = sessionListJson();
+    pCharacteristic->setValue(reinterpret_cast<const uint8_t *>(sessions.data), sessions.length);
+    // setValue keeps the old value when it refuses the new one; leave the
+    // list unserved so the next read tries again.
+    if (pCharacteristic->getValue().length() != sessions.length)
+    {
+        LOG_WARN("Session list of %u bytes not stored", static_cast<unsigned>(sessions.length));
+        served = false;
+        return;
     }
+    servedGeneration = sessions.generation;
+    served = true;
+
+    LOG_DEBUG("Retrieved sessions: %u bytes", static_cast<unsigned>(sessions.length));
+}
+
+// The attendance service. Rows follow GattCharacteristic; the checks below
+// catch a row out of place, a reused UUID or a handler without its property.
+static constexpr CharacteristicDescriptor gattTable[] = {
+    {GATT_CREATE_ATTENDANCE, "Create Attendance", CHAR_UUID_CREATE_ATTENDANCE, GATT_WRITE_PROPERTIES,
+     onCreateAttendanceWrite, METRIC_CB_CREATE_SESSION, nullptr, GATT_NO_METRIC, nullptr},
+    {GATT_MARK_ATTENDANCE, "Mark Attendance", CHAR_UUID_MARK_ATTENDANCE, GATT_WRITE_PROPERTIES,
+     onMarkAttendanceWrite, METRIC_CB_MARK, nullptr, GATT_NO_METRIC, nullptr},
+    {GATT_MARK_ATTENDANCE_BINARY, "Mark Attendance (binary)", CHAR_UUID_MARK_ATTENDANCE_BINARY, GATT_WRITE_PROPERTIES,
+     onMarkAttendanceBinaryWrite, METRIC_CB_MARK_BINARY, nullptr, GATT_NO_METRIC, nullptr},
+    {GATT_MARK_ATTENDANCE_BATCH, "Mark Attendance (batch)", CHAR_UUID_MARK_ATTENDANCE_BATCH,
+     NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::READ,
+     onMarkAttendanceBatchWrite, METRIC_CB_MARK_BATCH_WRITE, onMarkAttendanceBatchRead, METRIC_CB_MARK_BATCH_READ,
+     nullptr},
+    {GATT_WRITE_STATUS, "Write Status", CHAR_UUID_WRITE_STATUS, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY,
+     nullptr, GATT_NO_METRIC, onWriteStatusRead, METRIC_CB_WRITE_STATUS_READ, onWriteStatusSubscribe},
+    {GATT_TIME_SYNC, "Time Sync", CHAR_UUID_TIME_SYNC, GATT_WRITE_PROPERTIES,
+     onTimeSyncWrite, METRIC_CB_TIME_SYNC, nullptr, GATT_NO_METRIC, nullptr},
+    {GATT_ATTENDANCE_DELTAS, "Attendance Deltas", CHAR_UUID_ATTENDANCE_DELTAS, NIMBLE_PROPERTY::NOTIFY,
+     nullptr, GATT_NO_METRIC, nullptr, GATT_NO_METRIC, onAttendanceDeltasSubscribe},
+    {GATT_RETRIEVE_ATTENDANCES, "Retrieve Attendances", CHAR_UUID_RETRIEVE_ATTENDANCES, NIMBLE_PROPERTY::READ,
+     nullptr, GATT_NO_METRIC, onRetrieveAttendancesRead, METRIC_CB_RETRIEVE_ATTENDANCES, nullptr},
+    {GATT_RETRIEVE_SESSIONS, "Retrieve Sessions", CHAR_UUID_RETRIEVE_SESSIONS, NIMBLE_PROPERTY::READ,
+     nullptr, GATT_NO_METRIC, onRetrieveSessionsRead, METRIC_CB_RETRIEVE_SESSIONS, nullptr},
+    {GATT_ATTENDANCE_PAGE_REQUEST, "Attendance Page Request", CHAR_UUID_ATTENDANCE_PAGE_REQUEST, GATT_WRITE_PROPERTIES,
+     onAttendancePageRequestWrite, METRIC_CB_PAGE_REQUEST, nullptr, GATT_NO_METRIC, nullptr},
+    {GATT_ATTENDANCE_PAGE, "Attendance Page", CHAR_UUID_ATTENDANCE_PAGE, NIMBLE_PROPERTY::READ,
+     nullptr, GATT_NO_METRIC, onAttendancePageRead, METRIC_CB_PAGE_READ, nullptr},
+    {GATT_ATTENDANCE_EXPORT, "Attendance Export", CHAR_UUID_ATTENDANCE_EXPORT, NIMBLE_PROPERTY::READ,
+     nullptr, GATT_NO_METRIC, onAttendanceExportRead, METRIC_CB_EXPORT_READ, nullptr},
+    {GATT_METRICS, "Metrics", CHAR_UUID_METRICS, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY,
+     nullptr, GATT_NO_METRIC, onMetricsRead, METRIC_CB_METRICS_READ, nullptr},
 };
 
+static_assert(SESSION_LIST_JSON_MAX <= BLE_ATT_ATTR_MAX_LEN, "the session list must fit one characteristic value");
+static_assert(sizeof(gattTable) / sizeof(gattTable[0]) == GATT_CHARACTERISTIC_COUNT,
+              "every GattCharacteristic needs a row");
+static_assert(gattTableIsValid(gattTable), "characteristic table rows out of order, duplicated or inconsistent");
+
+static GattDispatcher gattDispatcher(gattTable, characteristics, GATT_CHARACTERISTIC_COUNT);
+
 void setup()
 {
+    // Only what the GATT callbacks touch is set up before advertising; the
+    // log drain, sweeper and journal replay start once the beacon is visible.
+    // Log lines written before then wait in the log buffer.
     Serial.begin(115200);
-    Serial.println("Starting BLE Attendance System!");
+    LOG_INFO("Starting BLE Attendance System!");
+
+    initStoreLock();
+    initStore();
 
-    NimBLEDevice::init("ESP32-Attendance");
-    Serial.println("NimBLE initialized");
+#if SHARDED_DEPLOYMENT
+    // Shards advertise 1-based, so a hall of four reads 1of4..4of4.
+    static char beaconName[sizeof(DEVICE_NAME) + 8];
+    snprintf(beaconName, sizeof(beaconName), "%s-%uof%u", DEVICE_NAME, SHARD_ID + 1, SHARD_COUNT);
+#else
+    static const char *beaconName = DEVICE_NAME;
+#endif
+    NimBLEDevice::init(beaconName);
+    recordBootMilestone(BOOT_BLE_READY);
 
     pServer = NimBLEDevice::createServer();
     pServer->setCallbacks(new ServerCallbacks());
-    Serial.println("Server created with callbacks");
+    LOG_DEBUG("Server created with callbacks");
 
     NimBLEService *pService = pServer->createService(SERVICE_UUID);
-    Serial.println("Service created");
-
-    pCreateAttendanceCharacteristic = pService->createCharacteristic(
-        CHAR_UUID_CREATE_ATTENDANCE,
-        NIMBLE_PROPERTY::WRITE_NR | NIMBLE_PROPERTY::WRITE);
-    pCreateAttendanceCharacteristic->setCallbacks(new CreateAttendanceCallback());
-    Serial.println("Create Attendance characteristic set up");
-
-    pMarkAttendanceCharacteristic = pService->createCharacteristic(
-        CHAR_UUID_MARK_ATTENDANCE,
-        NIMBLE_PROPERTY::WRITE_NR | NIMBLE_PROPERTY::WRITE);
-    pMarkAttendanceCharacteristic->setCallbacks(new MarkAttendanceCallback());
-    Serial.println("Mark Attendance characteristic set up");
-
-    pRetrieveAttendancesCharacteristic = pService->createCharacteristic(
-        CHAR_UUID_RETRIEVE_ATTENDANCES,
-        NIMBLE_PROPERTY::READ);
-    pRetrieveAttendancesCharacteristic->setCallbacks(new RetrieveAttendancesCallback());
-    Serial.println("Retrieve Attendances characteristic set up");
-
-    pRetrieveSessionsCharacteristic = pService->createCharacteristic(
-        CHAR_UUID_RETRIEVE_SESSIONS,
-        NIMBLE_PROPERTY::READ);
-    pRetrieveSessionsCharacteristic->setCallbacks(new RetrieveSessionsCallback());
-    Serial.println("Retrieve Sessions characteristic set up");
+    LOG_DEBUG("Service created");
+
+    gattDispatcher.registerCharacteristics(pService);
 
     pService->start();
-    Serial.println("Service started");
+    LOG_DEBUG("Service started");
 
     NimBLEAdvertising *pAdvertising = NimBLEDevice::getAdvertising();
+#if CONNECTIONLESS_MARKING
+    startConnectionless(beaconName, acceptConnectionlessMark);
+#else
     pAdvertising->addServiceUUID(SERVICE_UUID);
     pAdvertising->setScanResponse(true);
+#endif
     pAdvertising->setMinPreferred(0x06);
     pAdvertising->setMaxPreferred(0x12);
     pAdvertising->start();
-    Serial.println("Advertising started");
+    recordBootMilestone(BOOT_ADVERTISING);
+    startPowerManager();
+    startShardMesh(applyShardEntry);
+
+    logInit();
+    startExpirySweeper();
+    startJournalRestore();
 
-    Serial.println("BLE Attendance System is ready!");
+    LOG_INFO("BLE Attendance System is ready!");
 }
 
 void loop()
 {
-    delay(2000);
-    // Serial.println("Loop iteration");
-    // removeExpiredSessions();
+    // Applies the post-mark and idle disconnect policies at this period.
+    delay(powerLoopIntervalMs());
+
+    uint16_t due[MAX_CONNECTIONS];
+    size_t count = collectDueDisconnects(due, MAX_CONNECTIONS);
+    for (size_t i = 0; i < count; ++i)
+    {
+        LOG_DEBUG("Disconnecting connection %u", due[i]);
+        pServer->disconnect(due[i]);
+    }
+
+    serviceConnectionless();
+    serviceShardMesh();
+    servicePower();
+    notifyMetrics();
 }
@@ -0,0 +1,179 @@
+#include "metrics.h"
+
+#include <atomic>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+
+#include "boot_metrics.h"
+#include "connections.h"
+#include "journal.h"
+#include "log.h"
+#include "power_manager.h"
+
+#define METRICS_HEAP_CAPS (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#define WRITE_OPERATION_COUNT 5
+
+static const WriteStatus trackedStatuses[] = {
+    WRITE_STATUS_OK,
+    WRITE_STATUS_DUPLICATE,
+    WRITE_STATUS_MALFORMED,
+    WRITE_STATUS_INVALID_FIELD,
+    WRITE_STATUS_UNKNOWN_SESSION,
+    WRITE_STATUS_EXPIRED,
+    WRITE_STATUS_RATE_LIMITED,
+    WRITE_STATUS_SESSIONS_FULL,
+    WRITE_STATUS_STORAGE_FULL,
+    WRITE_STATUS_RESTORING,
+};
+#define TRACKED_STATUS_COUNT (sizeof(trackedStatuses) / sizeof(trackedStatuses[0]))
+
+static const uint32_t bucketBoundsMicros[METRICS_LATENCY_BUCKETS - 1] = {100, 250, 500, 1000, 2500, 5000, 10000};
+
+// Written from the host task and the loop task's notify, read by both.
+static std::atomic<uint32_t> outcomes[WRITE_OPERATION_COUNT][TRACKED_STATUS_COUNT];
+static std::atomic<uint16_t> latency[METRIC_CALLBACK_COUNT][METRICS_LATENCY_BUCKETS];
+
+void recordWriteOutcome(WriteOperation operation, WriteStatus status)
+{
+    if (operation < 1 || operation > WRITE_OPERATION_COUNT)
+    {
+        return;
+    }
+    for (size_t i = 0; i < TRACKED_STATUS_COUNT; ++i)
+    {
+        if (trackedStatuses[i] == status)
+        {
+            outcomes[operation - 1][i].fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+void recordCallbackLatency(MetricCallback callback, uint32_t micros)
+{
+    if (callback >= METRIC_CALLBACK_COUNT)
+    {
+        return;
+    }
+    size_t bucket = 0;
+    while (bucket < METRICS_LATENCY_BUCKETS - 1 && micros >= bucketBoundsMicros[bucket])
+    {
+        ++bucket;
+    }
+    // Saturate rather than wrap; a stuck bucket still reads as "a lot".
+    std::atomic<uint16_t> &count = latency[callback][bucket];
+    uint16_t current = count.load(std::memory_order_relaxed);
+    while (current != UINT16_MAX && !count.compare_exchange_weak(current, current + 1, std::memory_order_relaxed))
+    {
+    }
+}
+
+CallbackTimer::CallbackTimer(MetricCallback callback)
+    : callback(callback), startMicros(esp_timer_get_time())
+{
+}
+
+CallbackTimer::~CallbackTimer()
+{
+    recordCallbackLatency(callback, static_cast<uint32_t>(esp_timer_get_time() - startMicros));
+}
+
+static void writeUint16(uint8_t *out, uint16_t value)
+{
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+static void writeUint32(uint8_t *out, uint32_t value)
+{
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+    out[2] = static_cast<uint8_t>(value >> 16);
+    out[3] = static_cast<uint8_t>(value >> 24);
+}
+
+size_t encodeMetrics(uint8_t *out, size_t capacity)
+{
+    const size_t fixedBytes = 1 + 4 + 3 * 4 + 1 + 2 * 4 + BOOT_MILESTONE_COUNT * 4 + 2 + POWER_STATE_COUNT * 6 + 1 + 1;
+    if (capacity < fixedBytes)
+    {
+        return 0;
+    }
+
+    size_t pos = 0;
+    out[pos++] = METRICS_FORMAT_VERSION;
+    writeUint32(out + pos, static_cast<uint32_t>(esp_timer_get_time() / 1000000));
+    pos += 4;
+    writeUint32(out + pos, static_cast<uint32_t>(heap_caps_get_free_size(METRICS_HEAP_CAPS)));
+    pos += 4;
+    writeUint32(out + pos, static_cast<uint32_t>(heap_caps_get_minimum_free_size(METRICS_HEAP_CAPS)));
+    pos += 4;
+    writeUint32(out + pos, static_cast<uint32_t>(heap_caps_get_largest_free_block(METRICS_HEAP_CAPS)));
+    pos += 4;
+    out[pos++] = static_cast<uint8_t>(connectionCount());
+    writeUint32(out + pos, logDropCount());
+    pos += 4;
+    writeUint32(out + pos, journalDropCount());
+    pos += 4;
+    for (uint8_t milestone = 0; milestone < BOOT_MILESTONE_COUNT; ++milestone)
+    {
+        writeUint32(out + pos, bootMilestoneMillis(static_cast<BootMilestone>(milestone)));
+        pos += 4;
+    }
+    out[pos++] = currentPowerState();
+    out[pos++] = isLightSleepEnabled() ? 0x01 : 0x00;
+    for (uint8_t state = 0; state < POWER_STATE_COUNT; ++state)
+    {
+        writeUint32(out + pos, powerStateSeconds(static_cast<PowerState>(state)));
+        pos += 4;
+        writeUint16(out + pos, powerStateParams(static_cast<PowerState>(state)).estimatedMilliamps);
+        pos += 2;
+    }
+
+    // Both lists leave room for the other's count byte.
+    size_t outcomeCountPos = pos++;
+    uint8_t outcomeCount = 0;
+    for (size_t op = 0; op < WRITE_OPERATION_COUNT; ++op)
+    {
+        for (size_t i = 0; i < TRACKED_STATUS_COUNT; ++i)
+        {
+            uint32_t count = outcomes[op][i].load(std::memory_order_relaxed);
+            if (count == 0 || capacity - pos < 1 + 6)
+            {
+                continue;
+            }
+            out[pos++] = static_cast<uint8_t>(op + 1);
+            out[pos++] = static_cast<uint8_t>(trackedStatuses[i]);
+            writeUint32(out + pos, count);
+            pos += 4;
+            ++outcomeCount;
+        }
+    }
+    out[outcomeCountPos] = outcomeCount;
+
+    size_t histogramCountPos = pos++;
+    uint8_t histogramCount = 0;
+    for (uint8_t callback = 0; callback < METRIC_CALLBACK_COUNT; ++callback)
+    {
+        uint16_t counts[METRICS_LATENCY_BUCKETS];
+        bool any = false;
+        for (size_t bucket = 0; bucket < METRICS_LATENCY_BUCKETS; ++bucket)
+        {
+            counts[bucket] = latency[callback][bucket].load(std::memory_order_relaxed);
+            any = any || counts[bucket] != 0;
+        }
+        if (!any || capacity - pos < 1 + METRICS_LATENCY_BUCKETS * 2)
+        {
+            continue;
+        }
+        out[pos++] = callback;
+        for (uint16_t count : counts)
+        {
+            writeUint16(out + pos, count);
+            pos += 2;
+        }
+        ++histogramCount;
+    }
+    out[histogramCountPos] = histogramCount;
+    return pos;
+}
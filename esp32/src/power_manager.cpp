@@ -0,0 +1,162 @@
+#include "power_manager.h"
+
+#include <NimBLEDevice.h>
+#include <atomic>
+#include <esp_bt.h>
+#include <esp_pm.h>
+
+#include "clock.h"
+#include "connectionless.h"
+#include "log.h"
+#include "session_store.h"
+#include "shard_mesh.h"
+#include "store_lock.h"
+
+// The loop interval also sets how promptly the post-mark and idle disconnect
+// policies run, so it stays short while students are connecting. Current
+// estimates are for a WROOM module at 3.3 V with frequency scaling on.
+static const PowerStateParams states[] = {
+    // 30-50 ms advertising, 30% scan duty.
+    {"active", 48, 80, 100, 30, 250, 60},
+    // 200-250 ms advertising, 6% scan duty.
+    {"tapering", 320, 400, 500, 30, 250, 30},
+    // 1-1.2 s advertising, no scan: nothing to mark.
+    {"idle", 1600, 1920, 0, 0, 1000, 12},
+};
+
+// loop() only.
+static PowerState appliedState = POWER_ACTIVE;
+static uint64_t stateEnteredMillis = 0;
+static uint64_t settledMillis[POWER_STATE_COUNT];
+
+// Written from the host task, read by loop().
+static std::atomic<uint32_t> lastActivityMillis(0);
+
+// Written by loop(), read by the metrics encoder on the host task.
+static std::atomic<uint8_t> publishedState(POWER_ACTIVE);
+static std::atomic<uint32_t> publishedSeconds[POWER_STATE_COUNT];
+
+// Set once at boot.
+static bool lightSleep = false;
+
+const PowerStateParams &powerStateParams(PowerState state)
+{
+    return states[state];
+}
+
+static void configurePowerManagement()
+{
+#if CONFIG_BTDM_CTRL_MODEM_SLEEP
+    // Lets the controller power the radio down between advertising,
+    // scan and connection events.
+    esp_bt_sleep_enable();
+#endif
+
+#if CONFIG_PM_ENABLE
+    esp_pm_config_esp32_t config;
+    config.max_freq_mhz = POWER_MAX_CPU_MHZ;
+    config.min_freq_mhz = POWER_MIN_CPU_MHZ;
+    // ESP-NOW hears nothing while the chip sleeps.
+    config.light_sleep_enable = POWER_LIGHT_SLEEP != 0 && !SHARDED_DEPLOYMENT;
+    esp_err_t err = esp_pm_configure(&config);
+    if (err != ESP_OK && config.light_sleep_enable)
+    {
+        // Tickless idle is off in this SDK build; keep frequency scaling.
+        config.light_sleep_enable = false;
+        err = esp_pm_configure(&config);
+    }
+    if (err != ESP_OK)
+    {
+        LOG_WARN("Power management unavailable: %s", esp_err_to_name(err));
+        return;
+    }
+    lightSleep = config.light_sleep_enable;
+    LOG_INFO("CPU scales %u-%u MHz, light sleep %s", POWER_MIN_CPU_MHZ, POWER_MAX_CPU_MHZ,
+             lightSleep ? "on" : "off");
+#else
+    LOG_WARN("Power management is not enabled in this SDK build");
+#endif
+}
+
+static void applyState(const PowerStateParams &params)
+{
+    NimBLEAdvertising *advertising = NimBLEDevice::getAdvertising();
+    advertising->setMinInterval(params.minAdvInterval);
+    advertising->setMaxInterval(params.maxAdvInterval);
+    // New intervals apply from the next start. While every connection slot
+    // is taken advertising is off and picks them up when it restarts.
+    if (advertising->isAdvertising())
+    {
+        advertising->stop();
+        advertising->start();
+    }
+    setConnectionlessScan(params.scanInterval, params.scanWindow);
+}
+
+static PowerState desiredState(uint64_t now)
+{
+    size_t sessions = 0;
+    {
+        StoreLock lock;
+        sessions = activeSessionCount();
+    }
+    if (sessions == 0)
+    {
+        return POWER_IDLE;
+    }
+    uint32_t sinceActivity = static_cast<uint32_t>(now) - lastActivityMillis.load(std::memory_order_relaxed);
+    return sinceActivity < POWER_ACTIVE_HOLD_MS ? POWER_ACTIVE : POWER_TAPERING;
+}
+
+void startPowerManager()
+{
+    configurePowerManagement();
+    stateEnteredMillis = monotonicMillis();
+    // Boot counts as activity, so a beacon restored mid-session starts fast.
+    lastActivityMillis.store(static_cast<uint32_t>(stateEnteredMillis), std::memory_order_relaxed);
+    applyState(states[appliedState]);
+}
+
+void notePowerActivity()
+{
+    lastActivityMillis.store(static_cast<uint32_t>(monotonicMillis()), std::memory_order_relaxed);
+}
+
+void servicePower()
+{
+    uint64_t now = monotonicMillis();
+    PowerState next = desiredState(now);
+    if (next != appliedState)
+    {
+        settledMillis[appliedState] += now - stateEnteredMillis;
+        publishedSeconds[appliedState].store(static_cast<uint32_t>(settledMillis[appliedState] / 1000),
+                                             std::memory_order_relaxed);
+        stateEnteredMillis = now;
+        appliedState = next;
+        applyState(states[next]);
+        publishedState.store(next, std::memory_order_relaxed);
+        LOG_INFO("Power state: %s", states[next].name);
+    }
+    uint64_t inState = settledMillis[appliedState] + (now - stateEnteredMillis);
+    publishedSeconds[appliedState].store(static_cast<uint32_t>(inState / 1000), std::memory_order_relaxed);
+}
+
+PowerState currentPowerState()
+{
+    return static_cast<PowerState>(publishedState.load(std::memory_order_relaxed));
+}
+
+uint16_t powerLoopIntervalMs()
+{
+    return states[currentPowerState()].loopIntervalMs;
+}
+
+uint32_t powerStateSeconds(PowerState state)
+{
+    return publishedSeconds[state].load(std::memory_order_relaxed);
+}
+
+bool isLightSleepEnabled()
+{
+    return lightSleep;
+}
@@ -0,0 +1,55 @@
+#include "radio_profile.h"
+
+#include <NimBLEDevice.h>
+#include <soc/soc_caps.h>
+
+#include "log.h"
+
+// 4.2-only controllers (the original ESP32) have no 2M PHY to switch to.
+#if defined(SOC_BLE_50_SUPPORTED) && SOC_BLE_50_SUPPORTED
+#define RADIO_HAS_2M_PHY 1
+#else
+#define RADIO_HAS_2M_PHY 0
+#endif
+
+// Maximum LL payload from the Bluetooth 4.2 data length extension.
+#define LL_MAX_TX_OCTETS 251
+
+static const RadioProfileParams profiles[] = {
+    // 15-30 ms, 2 s timeout so dropped phones free their slot quickly.
+    {"many-students", 12, 24, 0, 200, 0, false},
+    // 7.5-15 ms, 4 s timeout; iOS clamps the floor to 15 ms.
+    {"burst-sync", 6, 12, 0, 400, LL_MAX_TX_OCTETS, true},
+};
+
+const RadioProfileParams &radioProfileParams(RadioProfile profile)
+{
+    return profiles[profile];
+}
+
+void applyRadioProfile(NimBLEServer *server, uint16_t connHandle, RadioProfile profile)
+{
+    const RadioProfileParams &params = radioProfileParams(profile);
+
+    server->updateConnParams(connHandle, params.minInterval, params.maxInterval,
+                             params.latency, params.timeout);
+
+    if (params.txOctets != 0)
+    {
+        server->setDataLen(connHandle, params.txOctets);
+    }
+
+#if RADIO_HAS_2M_PHY
+    if (params.prefer2M)
+    {
+        int rc = ble_gap_set_prefered_le_phy(connHandle, BLE_GAP_LE_PHY_2M_MASK,
+                                             BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_CODED_ANY);
+        if (rc != 0)
+        {
+            LOG_WARN("2M PHY request failed for connection %u (%d)", connHandle, rc);
+        }
+    }
+#endif
+
+    LOG_DEBUG("Connection %u using radio profile %s", connHandle, params.name);
+}
@@ -0,0 +1,59 @@
+#include "session_list_cache.h"
+
+#include "json_writer.h"
+#include "log.h"
+#include "session_store.h"
+#include "store_lock.h"
+
+static char cacheBuffer[SESSION_LIST_JSON_MAX];
+static size_t cacheLength = 0;
+static uint32_t cacheGeneration = 0;
+static bool cacheValid = false;
+
+static void regenerate()
+{
+    JsonWriter writer(cacheBuffer, sizeof(cacheBuffer));
+    writer.beginArray();
+
+    for (const SessionSlot &slot : sessionSlots())
+    {
+        if (!slot.inUse)
+        {
+            continue;
+        }
+
+        JsonWriter::Mark mark = writer.mark();
+        writer.beginObject();
+        writer.key("sessionId");
+        writer.value(slot.sessionId, slot.idLength);
+        writer.key("courseCode");
+        writer.value(slot.session.courseCode);
+        writer.key("courseName");
+        writer.value(slot.session.courseName);
+        writer.key("expiryTimestamp");
+        writer.value(slot.session.expiryTimestamp);
+        writer.endObject();
+        if (writer.full())
+        {
+            writer.rewind(mark);
+            LOG_WARN("Session list truncated at %u bytes", static_cast<unsigned>(writer.length()));
+            break;
+        }
+    }
+
+    writer.endArray();
+    cacheLength = writer.length();
+    LOG_DEBUG("Session list regenerated: %.*s", static_cast<int>(cacheLength), cacheBuffer);
+}
+
+SessionListJson sessionListJson()
+{
+    if (!cacheValid || cacheGeneration != sessionTableGeneration.load(std::memory_order_acquire))
+    {
+        StoreLock lock;
+        regenerate();
+        cacheGeneration = sessionTableGeneration.load(std::memory_order_relaxed);
+        cacheValid = true;
+    }
+    return {cacheBuffer, cacheLength, cacheGeneration};
+}
@@ -0,0 +1,444 @@
+#include "shard_mesh.h"
+
+#if SHARDED_DEPLOYMENT
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_now.h>
+#include <esp_wifi.h>
+#include <mbedtls/md.h>
+#include <string.h>
+
+#include "clock.h"
+#include "journal.h"
+#include "log.h"
+#include "shard_frames.h"
+
+#ifndef SHARD_MESH_KEY
+#error "A sharded deployment needs -DSHARD_MESH_KEY, shared by every beacon in the hall"
+#endif
+
+static_assert(SHARD_COUNT >= 2 && SHARD_COUNT <= SHARD_MAX_COUNT, "SHARD_COUNT must be 2..SHARD_MAX_COUNT");
+static_assert(SHARD_ID < SHARD_COUNT, "SHARD_ID must be below SHARD_COUNT");
+
+// Frames received but not yet processed by loop().
+#define SHARD_RX_QUEUE_DEPTH 32
+// Most entries replayed for one request; the peer asks again for the rest.
+#define SHARD_RESEND_BURST 8
+
+static const uint8_t broadcastAddress[ESP_NOW_ETH_ALEN] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+struct ReceivedFrame
+{
+    uint8_t length;
+    uint8_t data[SHARD_FRAME_MAX_BYTES];
+};
+
+struct ReplaySlot
+{
+    uint32_t sequence;
+    uint8_t length;
+    uint8_t entry[SHARD_ENTRY_MAX_BYTES];
+};
+
+// Where this beacon is in another one's stream.
+struct PeerState
+{
+    bool known;
+    uint32_t incarnation;
+    uint32_t nextSequence;
+    // Latest sequence the peer has announced.
+    uint32_t latestSequence;
+    uint64_t lastResendMillis;
+    // When nextSequence first came back SHARD_RETRY, or 0.
+    uint64_t stalledSinceMillis;
+};
+
+static ShardEntryHandler entryHandler = nullptr;
+static QueueHandle_t receiveQueue = nullptr;
+static uint32_t incarnation = 0;
+
+// Written under StoreLock by publishers, read by loop().
+static ReplaySlot replay[SHARD_REPLAY_SLOTS];
+static uint32_t publishedSequence = 0;
+static portMUX_TYPE replayLock = portMUX_INITIALIZER_UNLOCKED;
+
+// loop() only.
+static uint32_t sentSequence = 0;
+static uint64_t lastHeartbeatMillis = 0;
+static PeerState peers[SHARD_COUNT];
+
+static void computeMac(const uint8_t *data, size_t length, uint8_t *mac)
+{
+    static const char key[] = SHARD_MESH_KEY;
+    uint8_t digest[32];
+    const mbedtls_md_info_t *info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    mbedtls_md_hmac(info, reinterpret_cast<const unsigned char *>(key), sizeof(key) - 1, data, length, digest);
+    memcpy(mac, digest, SHARD_MAC_BYTES);
+}
+
+static bool verifyMac(const uint8_t *data, size_t signedLength)
+{
+    uint8_t expected[SHARD_MAC_BYTES];
+    computeMac(data, signedLength, expected);
+    uint8_t difference = 0;
+    for (size_t i = 0; i < SHARD_MAC_BYTES; ++i)
+    {
+        difference |= expected[i] ^ data[signedLength + i];
+    }
+    return difference == 0;
+}
+
+static bool sendFrame(const ShardFrame &frame)
+{
+    uint8_t out[SHARD_FRAME_MAX_BYTES];
+    size_t length = encodeShardFrame(frame, out, sizeof(out));
+    if (length == 0)
+    {
+        return false;
+    }
+    computeMac(out, length, out + length);
+    esp_err_t err = esp_now_send(broadcastAddress, out, length + SHARD_MAC_BYTES);
+    if (err != ESP_OK)
+    {
+        // Usually ESP_ERR_ESPNOW_NO_MEM: the driver's send queue is full.
+        LOG_DEBUG("ESP-NOW send failed: %s", esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
+
+static ShardFrame makeFrame(ShardFrameType type, uint32_t sequence)
+{
+    ShardFrame frame = {};
+    frame.type = type;
+    frame.shardId = SHARD_ID;
+    frame.incarnation = incarnation;
+    frame.sequence = sequence;
+    return frame;
+}
+
+// Copies out a retained entry. False once it has been overwritten.
+static bool replayEntry(uint32_t sequence, ReplaySlot &out)
+{
+    portENTER_CRITICAL(&replayLock);
+    const ReplaySlot &slot = replay[sequence % SHARD_REPLAY_SLOTS];
+    bool retained = slot.sequence == sequence && sequence != 0;
+    if (retained)
+    {
+        out = slot;
+    }
+    portEXIT_CRITICAL(&replayLock);
+    return retained;
+}
+
+static uint32_t oldestRetained(uint32_t latest)
+{
+    return latest > SHARD_REPLAY_SLOTS ? latest - SHARD_REPLAY_SLOTS + 1 : 1;
+}
+
+static uint32_t latestPublished()
+{
+    portENTER_CRITICAL(&replayLock);
+    uint32_t latest = publishedSequence;
+    portEXIT_CRITICAL(&replayLock);
+    return latest;
+}
+
+static bool sendEntry(uint32_t sequence)
+{
+    ReplaySlot slot;
+    if (!replayEntry(sequence, slot))
+    {
+        // Overwritten before it went out; peers skip past it.
+        return true;
+    }
+    ShardFrame frame = makeFrame(SHARD_FRAME_ENTRY, sequence);
+    frame.entry = slot.entry;
+    frame.entryLength = slot.length;
+    return sendFrame(frame);
+}
+
+static void publish(const uint8_t *entry, size_t length)
+{
+    if (length == 0 || length > SHARD_ENTRY_MAX_BYTES)
+    {
+        return;
+    }
+    portENTER_CRITICAL(&replayLock);
+    uint32_t sequence = ++publishedSequence;
+    ReplaySlot &slot = replay[sequence % SHARD_REPLAY_SLOTS];
+    slot.sequence = sequence;
+    slot.length = static_cast<uint8_t>(length);
+    memcpy(slot.entry, entry, length);
+    portEXIT_CRITICAL(&replayLock);
+}
+
+void shardPublishSession(const SessionSlot &slot)
+{
+    uint8_t entry[JOURNAL_ENTRY_MAX_BYTES];
+    publish(entry, encodeSessionEntry(slot, entry, sizeof(entry)));
+}
+
+void shardPublishMark(const SessionSlot &slot, const AttendanceRecord &record)
+{
+    uint8_t entry[JOURNAL_ENTRY_MAX_BYTES];
+    publish(entry, encodeMarkEntry(slot, record, entry, sizeof(entry)));
+}
+
+// The ESP-NOW callback runs on the Wi-Fi task; it only copies the frame out.
+static void onReceive(const uint8_t *mac, const uint8_t *data, int length)
+{
+    (void)mac;
+    if (length <= 0 || length > SHARD_FRAME_MAX_BYTES)
+    {
+        return;
+    }
+    ReceivedFrame frame;
+    frame.length = static_cast<uint8_t>(length);
+    memcpy(frame.data, data, length);
+    xQueueSend(receiveQueue, &frame, 0);
+}
+
+static void requestResend(uint8_t shardId, PeerState &peer, uint64_t now)
+{
+    if (peer.lastResendMillis != 0 && now - peer.lastResendMillis < SHARD_RESEND_INTERVAL_MS)
+    {
+        return;
+    }
+    ShardFrame frame = makeFrame(SHARD_FRAME_RESEND, peer.nextSequence);
+    frame.targetShard = shardId;
+    frame.targetIncarnation = peer.incarnation;
+    if (sendFrame(frame))
+    {
+        peer.lastResendMillis = now;
+    }
+}
+
+// A new incarnation means the peer rebooted and restarted its stream. What
+// it restored from its journal this beacon already holds.
+static PeerState &trackPeer(const ShardFrame &frame)
+{
+    PeerState &peer = peers[frame.shardId];
+    if (!peer.known || peer.incarnation != frame.incarnation)
+    {
+        if (peer.known)
+        {
+            LOG_INFO("Shard %u restarted", frame.shardId);
+        }
+        peer = {};
+        peer.known = true;
+        peer.incarnation = frame.incarnation;
+        peer.nextSequence = 1;
+    }
+    if (frame.sequence > peer.latestSequence)
+    {
+        peer.latestSequence = frame.sequence;
+    }
+    return peer;
+}
+
+static void skipTo(uint8_t shardId, PeerState &peer, uint32_t sequence)
+{
+    LOG_WARN("Shard %u: %lu entries no longer retained, skipping", shardId,
+             static_cast<unsigned long>(sequence - peer.nextSequence));
+    peer.nextSequence = sequence;
+    peer.stalledSinceMillis = 0;
+}
+
+static void handleEntry(const ShardFrame &frame, PeerState &peer, uint64_t now)
+{
+    if (frame.sequence != peer.nextSequence)
+    {
+        // Behind us is a repeat; ahead of us is a gap to fill first.
+        if (frame.sequence > peer.nextSequence)
+        {
+            requestResend(frame.shardId, peer, now);
+        }
+        return;
+    }
+
+    JournalEntry entry;
+    ShardApplyResult result = SHARD_RETRY;
+    if (decodeJournalEntry(frame.entry, frame.entryLength, entry) == frame.entryLength)
+    {
+        result = entryHandler(entry);
+    }
+    else
+    {
+        LOG_WARN("Shard %u sent a malformed entry", frame.shardId);
+        result = SHARD_APPLIED;
+    }
+
+    if (result == SHARD_RETRY)
+    {
+        if (peer.stalledSinceMillis == 0)
+        {
+            peer.stalledSinceMillis = now;
+        }
+        if (now - peer.stalledSinceMillis < SHARD_STALL_MS)
+        {
+            return;
+        }
+        LOG_WARN("Shard %u: entry %lu could not be applied, skipping", frame.shardId,
+                 static_cast<unsigned long>(frame.sequence));
+    }
+    ++peer.nextSequence;
+    peer.stalledSinceMillis = 0;
+    if (peer.latestSequence >= peer.nextSequence)
+    {
+        requestResend(frame.shardId, peer, now);
+    }
+}
+
+static void handleHeartbeat(const ShardFrame &frame, PeerState &peer, uint64_t now)
+{
+    if (frame.oldestSequence > peer.nextSequence)
+    {
+        skipTo(frame.shardId, peer, frame.oldestSequence);
+    }
+    if (frame.sequence >= peer.nextSequence)
+    {
+        requestResend(frame.shardId, peer, now);
+    }
+}
+
+static void handleResend(const ShardFrame &frame)
+{
+    if (frame.targetShard != SHARD_ID || frame.targetIncarnation != incarnation)
+    {
+        return;
+    }
+    uint32_t last = sentSequence;
+    uint32_t oldest = oldestRetained(latestPublished());
+    uint32_t first = frame.sequence > oldest ? frame.sequence : oldest;
+    for (uint32_t sequence = first; sequence <= last && sequence - first < SHARD_RESEND_BURST; ++sequence)
+    {
+        if (!sendEntry(sequence))
+        {
+            break;
+        }
+    }
+}
+
+static void handleFrame(const ReceivedFrame &received, uint64_t now)
+{
+    ShardFrame frame;
+    size_t signedLength = 0;
+    if (!decodeShardFrame(received.data, received.length, frame, signedLength) ||
+        frame.shardId == SHARD_ID || frame.shardId >= SHARD_COUNT)
+    {
+        return;
+    }
+    if (!verifyMac(received.data, signedLength))
+    {
+        LOG_WARN("Shard frame failed verification");
+        return;
+    }
+
+    if (frame.type == SHARD_FRAME_RESEND)
+    {
+        handleResend(frame);
+        return;
+    }
+    PeerState &peer = trackPeer(frame);
+    if (frame.type == SHARD_FRAME_ENTRY)
+    {
+        handleEntry(frame, peer, now);
+    }
+    else
+    {
+        handleHeartbeat(frame, peer, now);
+    }
+}
+
+void startShardMesh(ShardEntryHandler handler)
+{
+    entryHandler = handler;
+    receiveQueue = xQueueCreate(SHARD_RX_QUEUE_DEPTH, sizeof(ReceivedFrame));
+    // Tells this beacon's stream apart from the one before its last reset.
+    incarnation = esp_random();
+
+    WiFi.mode(WIFI_STA);
+    WiFi.disconnect();
+    esp_wifi_set_channel(SHARD_WIFI_CHANNEL, WIFI_SECOND_CHAN_NONE);
+    if (esp_now_init() != ESP_OK)
+    {
+        LOG_ERROR("ESP-NOW init failed, this shard will not merge with its peers");
+        return;
+    }
+    esp_now_register_recv_cb(onReceive);
+
+    esp_now_peer_info_t peer = {};
+    memcpy(peer.peer_addr, broadcastAddress, ESP_NOW_ETH_ALEN);
+    peer.channel = SHARD_WIFI_CHANNEL;
+    peer.ifidx = WIFI_IF_STA;
+    peer.encrypt = false;
+    if (esp_now_add_peer(&peer) != ESP_OK)
+    {
+        LOG_ERROR("Cannot add the ESP-NOW broadcast peer");
+        return;
+    }
+    LOG_INFO("Shard %u of %u on channel %u", SHARD_ID, SHARD_COUNT, SHARD_WIFI_CHANNEL);
+}
+
+void serviceShardMesh()
+{
+    if (receiveQueue == nullptr)
+    {
+        return;
+    }
+
+    // Peers' entries wait until the journal replay has rebuilt the table
+    // they apply to.
+    uint64_t now = monotonicMillis();
+    ReceivedFrame received;
+    while (isJournalRestored() && xQueueReceive(receiveQueue, &received, 0) == pdTRUE)
+    {
+        handleFrame(received, now);
+    }
+
+    uint32_t latest = latestPublished();
+    if (latest - sentSequence > SHARD_REPLAY_SLOTS)
+    {
+        sentSequence = latest - SHARD_REPLAY_SLOTS;
+    }
+    while (sentSequence < latest && sendEntry(sentSequence + 1))
+    {
+        ++sentSequence;
+    }
+
+    if (now - lastHeartbeatMillis >= SHARD_HEARTBEAT_MS)
+    {
+        ShardFrame heartbeat = makeFrame(SHARD_FRAME_HEARTBEAT, sentSequence);
+        heartbeat.oldestSequence = oldestRetained(latest);
+        if (sendFrame(heartbeat))
+        {
+            lastHeartbeatMillis = now;
+        }
+    }
+}
+
+#else
+
+void startShardMesh(ShardEntryHandler handler)
+{
+    (void)handler;
+}
+
+void shardPublishSession(const SessionSlot &slot)
+{
+    (void)slot;
+}
+
+void shardPublishMark(const SessionSlot &slot, const AttendanceRecord &record)
+{
+    (void)slot;
+    (void)record;
+}
+
+void serviceShardMesh()
+{
+}
+
+#endif
@@ -0,0 +1,24 @@
+#include "store_lock.h"
+
+#include <Arduino.h>
+#include <freertos/semphr.h>
+
+static SemaphoreHandle_t storeMutex = nullptr;
+
+void initStoreLock()
+{
+    if (storeMutex == nullptr)
+    {
+        storeMutex = xSemaphoreCreateMutex();
+    }
+}
+
+StoreLock::StoreLock()
+{
+    xSemaphoreTake(storeMutex, portMAX_DELAY);
+}
+
+StoreLock::~StoreLock()
+{
+    xSemaphoreGive(storeMutex);
+}
@@ -0,0 +1,108 @@
+#include "store_memory.h"
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+
+#include "log.h"
+#include "record_pool.h"
+#include "session_store.h"
+
+#define STORE_HEAP_CAPS (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#define STORE_PSRAM_CAPS (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+// Records of the fallback plan may come from any byte-addressable heap.
+#define STORE_FALLBACK_CAPS MALLOC_CAP_8BIT
+
+// Failed PSRAM record allocations before the store gives up on PSRAM and
+// falls back to the internal-only plan.
+#ifndef STORE_PSRAM_ATTEMPTS
+#define STORE_PSRAM_ATTEMPTS 3
+#endif
+
+static size_t spareHeapBytes()
+{
+    size_t freeBytes = heap_caps_get_free_size(STORE_HEAP_CAPS);
+    return freeBytes > STORE_HEAP_RESERVE_BYTES ? freeBytes - STORE_HEAP_RESERVE_BYTES : 0;
+}
+
+// Budget for the record array in PSRAM, or 0 to keep it in internal SRAM.
+static size_t externalBudgetBytes()
+{
+#ifdef STORE_RECORDS_IN_PSRAM
+    size_t freeBytes = heap_caps_get_free_size(STORE_PSRAM_CAPS);
+    return freeBytes < STORE_PSRAM_BUDGET_BYTES ? freeBytes : STORE_PSRAM_BUDGET_BYTES;
+#else
+    return 0;
+#endif
+}
+
+StoreCapacity initStore()
+{
+    size_t budget = spareHeapBytes();
+    if (budget > STORE_RAM_BUDGET_BYTES)
+    {
+        budget = STORE_RAM_BUDGET_BYTES;
+    }
+    const size_t internalBudget = budget;
+    size_t externalBudget = externalBudgetBytes();
+    const char *plan = externalBudget > 0 ? "PSRAM" : "internal";
+    uint32_t recordCaps = STORE_HEAP_CAPS;
+    unsigned psramFailures = 0;
+#ifdef STORE_RECORDS_IN_PSRAM
+    if (externalBudget == 0)
+    {
+        LOG_WARN("No PSRAM found, keeping records in internal SRAM");
+    }
+#endif
+
+    for (;;)
+    {
+        bool external = externalBudget > 0;
+        StoreCapacity capacity = external
+                                     ? planTieredStoreCapacity(budget, externalBudget, sizeof(SessionSlot), sizeof(AttendanceRecord))
+                                     : planStoreCapacity(budget, sizeof(SessionSlot), RECORD_CHUNK_BYTES);
+        if (capacity.sessions == 0)
+        {
+            LOG_ERROR("No heap for the attendance store (%u bytes spare)", static_cast<unsigned>(spareHeapBytes()));
+            initSessionTable(nullptr, 0);
+            initRecordPool(nullptr, nullptr, 0);
+            return capacity;
+        }
+
+        size_t chunks = capacity.records / RECORD_CHUNK_SIZE;
+        void *slots = heap_caps_calloc(capacity.sessions, sizeof(SessionSlot), STORE_HEAP_CAPS);
+        void *records = heap_caps_malloc(capacity.records * sizeof(AttendanceRecord),
+                                         external ? STORE_PSRAM_CAPS : recordCaps);
+        void *links = heap_caps_malloc(chunks * sizeof(uint16_t), STORE_HEAP_CAPS);
+        if (slots != nullptr && records != nullptr && links != nullptr)
+        {
+            initSessionTable(static_cast<SessionSlot *>(slots), capacity.sessions);
+            initRecordPool(static_cast<AttendanceRecord *>(records), static_cast<uint16_t *>(links), capacity.records);
+            LOG_INFO("Store (%s plan): %u sessions, %u records, %u bytes internal, %u bytes PSRAM", plan,
+                     static_cast<unsigned>(capacity.sessions), static_cast<unsigned>(capacity.records),
+                     static_cast<unsigned>(capacity.bytes), static_cast<unsigned>(capacity.externalBytes));
+            return capacity;
+        }
+
+        bool recordsFailed = records == nullptr;
+        heap_caps_free(slots);
+        heap_caps_free(records);
+        heap_caps_free(links);
+
+        // PSRAM that is detected but will not hand out the block (a bad
+        // module, or a heap already carved up) should not shrink the store
+        // to nothing: plan as a board without PSRAM, from the full budget.
+        if (external && recordsFailed && ++psramFailures >= STORE_PSRAM_ATTEMPTS)
+        {
+            LOG_WARN("PSRAM allocation failed %u times, falling back to the internal plan", psramFailures);
+            externalBudget = 0;
+            budget = internalBudget;
+            recordCaps = STORE_FALLBACK_CAPS;
+            plan = "fallback";
+            continue;
+        }
+
+        // A fragmented heap can have the bytes but not the contiguous block.
+        budget = budget / 4 * 3;
+        externalBudget = externalBudget / 4 * 3;
+    }
+}
@@ -0,0 +1,240 @@
+// Host benchmarks for the store and the serializers. Each case reports its
+// cost per operation and fails if it goes over a budget set with plenty of
+// headroom for a slow CI machine, so only real regressions trip it.
+//
+//   pio test -e native -f test_bench_store
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "export_format.h"
+#include "json_writer.h"
+#include "record_pool.h"
+#include "session_store.h"
+#include "store_capacity.h"
+#include "wire_format.h"
+
+#define BENCH_POOL_RECORDS (STORE_MAX_SESSIONS * MAX_RECORDS_PER_SESSION)
+#define BENCH_ROUNDS 50
+
+static SessionSlot slots[STORE_MAX_SESSIONS];
+static AttendanceRecord records[BENCH_POOL_RECORDS];
+static uint16_t chunkLinks[BENCH_POOL_RECORDS / RECORD_CHUNK_SIZE];
+
+typedef std::chrono::steady_clock BenchClock;
+
+static double nanosPerOp(BenchClock::time_point start, size_t operations)
+{
+    std::chrono::duration<double, std::nano> elapsed = BenchClock::now() - start;
+    return elapsed.count() / static_cast<double>(operations);
+}
+
+static void report(const char *name, double nanos, double budgetNanos)
+{
+    char line[96];
+    snprintf(line, sizeof(line), "%s: %.0f ns/op (budget %.0f)", name, nanos, budgetNanos);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_TRUE_MESSAGE(nanos <= budgetNanos, line);
+}
+
+static void matricFor(size_t index, char *out, size_t capacity)
+{
+    snprintf(out, capacity, "CSC/2019/%05u", static_cast<unsigned>(index));
+}
+
+static SessionSlot &freshSession(const char *id)
+{
+    memset(slots, 0, sizeof(slots));
+    initSessionTable(slots, STORE_MAX_SESSIONS);
+    initRecordPool(records, chunkLinks, BENCH_POOL_RECORDS);
+    return *claimSession(id, strlen(id));
+}
+
+static void fillSession(SessionSlot &slot, size_t count)
+{
+    char matric[RECORD_MATRIC_MAX_LEN + 1];
+    char name[RECORD_NAME_MAX_LEN + 1];
+    for (size_t i = 0; i < count; ++i)
+    {
+        matricFor(i, matric, sizeof(matric));
+        snprintf(name, sizeof(name), "Student Okonkwo-Bello %u", static_cast<unsigned>(i));
+        AttendanceRecord *record = nullptr;
+        addAttendance(slot, name, strlen(name), matric, strlen(matric), 1760000000 + i * 3, record);
+    }
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void bench_add_attendance()
+{
+    double total = 0;
+    for (int round = 0; round < BENCH_ROUNDS; ++round)
+    {
+        SessionSlot &slot = freshSession("bench-session");
+        BenchClock::time_point start = BenchClock::now();
+        fillSession(slot, MAX_RECORDS_PER_SESSION);
+        total += nanosPerOp(start, MAX_RECORDS_PER_SESSION);
+        TEST_ASSERT_EQUAL(MAX_RECORDS_PER_SESSION, slot.attendances.count);
+    }
+    report("addAttendance into a filling session", total / BENCH_ROUNDS, 2000);
+}
+
+void bench_duplicate_mark()
+{
+    SessionSlot &slot = freshSession("bench-session");
+    fillSession(slot, MAX_RECORDS_PER_SESSION);
+
+    char matric[RECORD_MATRIC_MAX_LEN + 1];
+    BenchClock::time_point start = BenchClock::now();
+    for (int round = 0; round < BENCH_ROUNDS; ++round)
+    {
+        for (size_t i = 0; i < MAX_RECORDS_PER_SESSION; ++i)
+        {
+            matricFor(i, matric, sizeof(matric));
+            AttendanceRecord *record = nullptr;
+            TEST_ASSERT_EQUAL(ATTENDANCE_DUPLICATE,
+                              addAttendance(slot, "x", 1, matric, strlen(matric), 1760000000, record));
+        }
+    }
+    report("duplicate mark against a full session", nanosPerOp(start, BENCH_ROUNDS * MAX_RECORDS_PER_SESSION), 1000);
+}
+
+void bench_find_session()
+{
+    memset(slots, 0, sizeof(slots));
+    initSessionTable(slots, STORE_MAX_SESSIONS);
+    initRecordPool(records, chunkLinks, BENCH_POOL_RECORDS);
+    char id[32];
+    for (size_t i = 0; i < STORE_MAX_SESSIONS; ++i)
+    {
+        snprintf(id, sizeof(id), "session-%02u-0c9f1e2a", static_cast<unsigned>(i));
+        claimSession(id, strlen(id));
+    }
+
+    const size_t lookups = 100000;
+    BenchClock::time_point start = BenchClock::now();
+    for (size_t i = 0; i < lookups; ++i)
+    {
+        snprintf(id, sizeof(id), "session-%02u-0c9f1e2a", static_cast<unsigned>(i % STORE_MAX_SESSIONS));
+        TEST_ASSERT_NOT_NULL(findSession(id, strlen(id)));
+    }
+    report("findSession in a full table", nanosPerOp(start, lookups), 1000);
+}
+
+void bench_decode_mark()
+{
+    MarkAttendanceMessage message;
+    message.sessionId = makeWireString("5f0c9b2e-7d1a-4c33-9f0e-2b8a6d4e1c77");
+    message.name = makeWireString("Adaeze Okonkwo-Bello");
+    message.matricNumber = makeWireString("CSC/2019/00042");
+    message.timestamp = 1760000000;
+    uint8_t payload[WIRE_MARK_MAX_BYTES];
+    size_t length = encodeMarkAttendance(message, payload, sizeof(payload));
+
+    const size_t decodes = 200000;
+    BenchClock::time_point start = BenchClock::now();
+    for (size_t i = 0; i < decodes; ++i)
+    {
+        MarkAttendanceMessage decoded;
+        TEST_ASSERT_TRUE(decodeMarkAttendance(payload, length, decoded));
+    }
+    report("decodeMarkAttendance", nanosPerOp(start, decodes), 500);
+}
+
+void bench_export_session()
+{
+    SessionSlot &slot = freshSession("bench-session");
+    fillSession(slot, MAX_RECORDS_PER_SESSION);
+
+    static AttendanceRecord copy[EXPORT_MAX_RECORDS];
+    uint8_t block[500];
+    size_t bytes = 0;
+    BenchClock::time_point start = BenchClock::now();
+    for (int round = 0; round < BENCH_ROUNDS; ++round)
+    {
+        size_t offset = 0;
+        bytes = 0;
+        while (offset < slot.attendances.count)
+        {
+            RecordCursor cursor = recordCursorAt(slot.attendances, offset);
+            size_t copied = 0;
+            while (copied < EXPORT_MAX_RECORDS)
+            {
+                const AttendanceRecord *record = nextRecord(slot.attendances, cursor);
+                if (record == nullptr)
+                {
+                    break;
+                }
+                copy[copied++] = *record;
+            }
+            size_t count = 0;
+            bytes += encodeExportBlock(slot.idHash, copy, copied, offset, slot.attendances.count, block,
+                                       sizeof(block), count);
+            offset += count;
+        }
+    }
+    report("export per record", nanosPerOp(start, BENCH_ROUNDS * MAX_RECORDS_PER_SESSION), 2000);
+
+    char line[64];
+    snprintf(line, sizeof(line), "export size: %.1f bytes/record",
+             static_cast<double>(bytes) / MAX_RECORDS_PER_SESSION);
+    TEST_MESSAGE(line);
+}
+
+void bench_json_records()
+{
+    SessionSlot &slot = freshSession("bench-session");
+    fillSession(slot, MAX_RECORDS_PER_SESSION);
+
+    static char json[64 * 1024];
+    size_t written = 0;
+    BenchClock::time_point start = BenchClock::now();
+    for (int round = 0; round < BENCH_ROUNDS; ++round)
+    {
+        JsonWriter writer(json, sizeof(json));
+        writer.beginArray();
+        RecordCursor cursor = recordCursorAt(slot.attendances, 0);
+        while (const AttendanceRecord *record = nextRecord(slot.attendances, cursor))
+        {
+            writer.beginObject();
+            writer.key("seq");
+            writer.value(static_cast<unsigned long>(record->sequence));
+            writer.key("name");
+            writer.value(record->name);
+            writer.key("matricNumber");
+            writer.value(record->matricNumber);
+            writer.key("timestamp");
+            writer.value(static_cast<unsigned long>(record->timestamp));
+            writer.endObject();
+        }
+        writer.endArray();
+        TEST_ASSERT_FALSE(writer.full());
+        written = writer.length();
+    }
+    report("JSON record serialization", nanosPerOp(start, BENCH_ROUNDS * MAX_RECORDS_PER_SESSION), 2000);
+
+    char line[64];
+    snprintf(line, sizeof(line), "JSON size: %.1f bytes/record",
+             static_cast<double>(written) / MAX_RECORDS_PER_SESSION);
+    TEST_MESSAGE(line);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(bench_add_attendance);
+    RUN_TEST(bench_duplicate_mark);
+    RUN_TEST(bench_find_session);
+    RUN_TEST(bench_decode_mark);
+    RUN_TEST(bench_export_session);
+    RUN_TEST(bench_json_records);
+    return UNITY_END();
+}
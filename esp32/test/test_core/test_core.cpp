@@ -0,0 +1,556 @@
+// Host unit tests for lib/attendance_core: the store, the clock, the binary and JSON
+// codecs and the streaming writer.
+//
+//   pio test -e native -f test_core
+
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "beacon_frames.h"
+#include "epoch_clock.h"
+#include "export_format.h"
+#include "journal_format.h"
+#include "json_requests.h"
+#include "json_writer.h"
+#include "record_pool.h"
+#include "session_store.h"
+#include "shard_frames.h"
+#include "store_capacity.h"
+#include "wire_format.h"
+
+#define TEST_POOL_RECORDS (STORE_MAX_SESSIONS * MAX_RECORDS_PER_SESSION)
+
+static SessionSlot slots[STORE_MAX_SESSIONS];
+static AttendanceRecord records[TEST_POOL_RECORDS];
+static uint16_t chunkLinks[TEST_POOL_RECORDS / RECORD_CHUNK_SIZE];
+
+static MarkAttendanceMessage sampleMark()
+{
+    MarkAttendanceMessage message;
+    message.sessionId = makeWireString("5f0c9b2e-7d1a-4c33-9f0e-2b8a6d4e1c77");
+    message.name = makeWireString("Adaeze Okonkwo-Bello");
+    message.matricNumber = makeWireString("CSC/2019/00042");
+    message.timestamp = 1760000000;
+    return message;
+}
+
+static void assertWireString(const char *expected, WireString actual)
+{
+    TEST_ASSERT_EQUAL(strlen(expected), actual.length);
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual.data, actual.length);
+}
+
+static bool addMark(SessionSlot &slot, const char *matric)
+{
+    AttendanceRecord *record = nullptr;
+    return addAttendance(slot, "Student", 7, matric, strlen(matric), 1760000000, record) == ATTENDANCE_ADDED;
+}
+
+void setUp()
+{
+    memset(slots, 0, sizeof(slots));
+    initSessionTable(slots, STORE_MAX_SESSIONS);
+    initRecordPool(records, chunkLinks, TEST_POOL_RECORDS);
+}
+
+void tearDown()
+{
+}
+
+void test_mark_round_trip()
+{
+    MarkAttendanceMessage message = sampleMark();
+    uint8_t payload[WIRE_MARK_MAX_BYTES];
+    size_t length = encodeMarkAttendance(message, payload, sizeof(payload));
+    TEST_ASSERT_GREATER_THAN(0, length);
+
+    MarkAttendanceMessage decoded;
+    TEST_ASSERT_TRUE(decodeMarkAttendance(payload, length, decoded));
+    assertWireString("5f0c9b2e-7d1a-4c33-9f0e-2b8a6d4e1c77", decoded.sessionId);
+    assertWireString("Adaeze Okonkwo-Bello", decoded.name);
+    assertWireString("CSC/2019/00042", decoded.matricNumber);
+    TEST_ASSERT_EQUAL_UINT32(1760000000, decoded.timestamp);
+}
+
+void test_mark_rejects_bad_framing()
+{
+    MarkAttendanceMessage message = sampleMark();
+    uint8_t payload[WIRE_MARK_MAX_BYTES + 1];
+    size_t length = encodeMarkAttendance(message, payload, sizeof(payload));
+    MarkAttendanceMessage decoded;
+
+    TEST_ASSERT_FALSE(decodeMarkAttendance(payload, length - 1, decoded));
+    TEST_ASSERT_FALSE(decodeMarkAttendance(payload, length + 1, decoded));
+    payload[0] = WIRE_FORMAT_VERSION + 1;
+    TEST_ASSERT_FALSE(decodeMarkAttendance(payload, length, decoded));
+    TEST_ASSERT_EQUAL(0, encodeMarkAttendance(message, payload, length - 1));
+}
+
+void test_batch_walks_each_record()
+{
+    // Session "s1", two records.
+    const uint8_t batch[] = {
+        WIRE_FORMAT_VERSION, 2, 's', '1', 2,
+        1, 'A', 'M', '1', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x10, 0, 0, 0,
+        1, 'B', 'M', '2', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x20, 0, 0, 0,
+    };
+    MarkBatch decoded;
+    TEST_ASSERT_TRUE(decodeMarkBatch(batch, sizeof(batch), decoded));
+    assertWireString("s1", decoded.sessionId);
+    TEST_ASSERT_EQUAL(2, decoded.count);
+
+    size_t pos = 0;
+    MarkAttendanceMessage record;
+    TEST_ASSERT_TRUE(nextBatchRecord(decoded, pos, record));
+    assertWireString("M1", record.matricNumber);
+    TEST_ASSERT_EQUAL_UINT32(0x10, record.timestamp);
+    TEST_ASSERT_TRUE(nextBatchRecord(decoded, pos, record));
+    assertWireString("B", record.name);
+    TEST_ASSERT_FALSE(nextBatchRecord(decoded, pos, record));
+
+    TEST_ASSERT_FALSE(decodeMarkBatch(batch, sizeof(batch) - 1, decoded));
+}
+
+void test_store_rejects_duplicate_matric()
+{
+    SessionSlot *slot = claimSession("s1", 2);
+    TEST_ASSERT_NOT_NULL(slot);
+    TEST_ASSERT_TRUE(addMark(*slot, "CSC/2019/00042"));
+
+    AttendanceRecord *record = nullptr;
+    TEST_ASSERT_EQUAL(ATTENDANCE_DUPLICATE,
+                      addAttendance(*slot, "Other", 5, "CSC/2019/00042", 14, 1760000001, record));
+    TEST_ASSERT_EQUAL(1, slot->attendances.count);
+
+    // Marks are per session.
+    SessionSlot *other = claimSession("s2", 2);
+    TEST_ASSERT_TRUE(addMark(*other, "CSC/2019/00042"));
+}
+
+void test_store_claim_find_release()
+{
+    SessionSlot *slot = claimSession("s1", 2);
+    TEST_ASSERT_EQUAL_PTR(slot, claimSession("s1", 2));
+    TEST_ASSERT_EQUAL_PTR(slot, findSession("s1", 2));
+    TEST_ASSERT_NULL(findSession("s", 1));
+    TEST_ASSERT_EQUAL(1, activeSessionCount());
+
+    size_t freeBefore = freeRecordCapacity();
+    TEST_ASSERT_TRUE(addMark(*slot, "M1"));
+    TEST_ASSERT_LESS_THAN(freeBefore, freeRecordCapacity());
+
+    releaseSession(slot);
+    TEST_ASSERT_NULL(findSession("s1", 2));
+    TEST_ASSERT_EQUAL(0, activeSessionCount());
+    TEST_ASSERT_EQUAL(freeBefore, freeRecordCapacity());
+}
+
+void test_store_fills_every_slot()
+{
+    char id[16];
+    for (size_t i = 0; i < STORE_MAX_SESSIONS; ++i)
+    {
+        snprintf(id, sizeof(id), "s%u", static_cast<unsigned>(i));
+        TEST_ASSERT_NOT_NULL(claimSession(id, strlen(id)));
+    }
+    TEST_ASSERT_NULL(claimSession("one-too-many", 12));
+}
+
+void test_records_iterate_in_order()
+{
+    SessionSlot *slot = claimSession("s1", 2);
+    char matric[RECORD_MATRIC_MAX_LEN + 1];
+    const size_t count = RECORD_CHUNK_SIZE * 2 + 3;
+    for (size_t i = 0; i < count; ++i)
+    {
+        snprintf(matric, sizeof(matric), "M%u", static_cast<unsigned>(i));
+        TEST_ASSERT_TRUE(addMark(*slot, matric));
+    }
+
+    RecordCursor cursor = recordCursorAt(slot->attendances, RECORD_CHUNK_SIZE + 1);
+    size_t index = RECORD_CHUNK_SIZE + 1;
+    while (const AttendanceRecord *record = nextRecord(slot->attendances, cursor))
+    {
+        snprintf(matric, sizeof(matric), "M%u", static_cast<unsigned>(index));
+        TEST_ASSERT_EQUAL_STRING(matric, record->matricNumber);
+        ++index;
+    }
+    TEST_ASSERT_EQUAL(count, index);
+}
+
+void test_journal_round_trip()
+{
+    uint8_t entry[JOURNAL_ENTRY_MAX_BYTES];
+    MarkAttendanceMessage message = sampleMark();
+    size_t length = encodeJournalMark(message, entry, sizeof(entry));
+    TEST_ASSERT_GREATER_THAN(0, length);
+
+    JournalEntry decoded;
+    TEST_ASSERT_EQUAL(length, decodeJournalEntry(entry, length, decoded));
+    TEST_ASSERT_EQUAL(JOURNAL_MARK, decoded.type);
+    MarkAttendanceMessage mark;
+    TEST_ASSERT_TRUE(decodeJournalMark(decoded, mark));
+    assertWireString("CSC/2019/00042", mark.matricNumber);
+
+    // A torn tail or a flipped bit fails the check.
+    TEST_ASSERT_EQUAL(0, decodeJournalEntry(entry, length - 1, decoded));
+    entry[4] ^= 0x01;
+    TEST_ASSERT_EQUAL(0, decodeJournalEntry(entry, length, decoded));
+}
+
+void test_journal_session_entry()
+{
+    JournalSession session;
+    session.sessionId = makeWireString("s1");
+    session.courseCode = makeWireString("CSC 401");
+    session.courseName = makeWireString("Compilers");
+    session.expiryTimestamp = 1760003600;
+    uint8_t entry[JOURNAL_ENTRY_MAX_BYTES];
+    size_t length = encodeJournalSession(session, entry, sizeof(entry));
+
+    JournalEntry decoded;
+    TEST_ASSERT_EQUAL(length, decodeJournalEntry(entry, length, decoded));
+    JournalSession restored;
+    TEST_ASSERT_TRUE(decodeJournalSession(decoded, restored));
+    assertWireString("Compilers", restored.courseName);
+    TEST_ASSERT_EQUAL_UINT32(1760003600, restored.expiryTimestamp);
+    WireString closed;
+    TEST_ASSERT_FALSE(decodeJournalClose(decoded, closed));
+}
+
+void test_clock_ignores_later_client_timestamps()
+{
+    EpochClock clock;
+    resetEpochClock(clock);
+    uint32_t now = 0;
+    TEST_ASSERT_FALSE(readEpochClock(clock, 1000, now));
+
+    TEST_ASSERT_TRUE(observeEpochClock(clock, 1760000000, 1000));
+    // A phone a day fast does not drag the clock with it.
+    TEST_ASSERT_FALSE(observeEpochClock(clock, 1760086400, 2000));
+    TEST_ASSERT_TRUE(readEpochClock(clock, 11000, now));
+    TEST_ASSERT_EQUAL_UINT32(1760000010, now);
+}
+
+void test_clock_skewed_mark_then_sync()
+{
+    EpochClock clock;
+    resetEpochClock(clock);
+    uint32_t now = 0;
+
+    // The first mark after a reboot comes from a phone an hour fast.
+    observeEpochClock(clock, 1760003600, 1000);
+    TEST_ASSERT_TRUE(readEpochClock(clock, 1000, now));
+    TEST_ASSERT_EQUAL_UINT32(1760003600, now);
+
+    // The lecturer's sync wins even though it moves time back.
+    syncEpochClock(clock, 1760000000, 2000);
+    TEST_ASSERT_TRUE(readEpochClock(clock, 2000, now));
+    TEST_ASSERT_EQUAL_UINT32(1760000000, now);
+    TEST_ASSERT_FALSE(observeEpochClock(clock, 1760007200, 3000));
+    TEST_ASSERT_TRUE(readEpochClock(clock, 5000, now));
+    TEST_ASSERT_EQUAL_UINT32(1760000003, now);
+
+    // Until the next sync the clock still never reads lower.
+    TEST_ASSERT_TRUE(readEpochClock(clock, 4000, now));
+    TEST_ASSERT_EQUAL_UINT32(1760000003, now);
+}
+
+void test_mark_frame_decode()
+{
+    uint8_t frame[] = {
+        0xFF, 0xFF, BEACON_FRAME_MARK,
+        0x78, 0x56, 0x34, 0x12,
+        0x00, 0xE1, 0xE6, 0x68,
+        'C', 'S', 'C', '4', '2',
+        0xAA, 0xBB, 0xCC, 0xDD,
+    };
+    MarkFrame decoded;
+    TEST_ASSERT_TRUE(decodeMarkFrame(frame, sizeof(frame), decoded));
+    TEST_ASSERT_EQUAL_HEX32(0x12345678, decoded.sessionTag);
+    TEST_ASSERT_EQUAL_HEX32(0x68E6E100, decoded.timestamp);
+    assertWireString("CSC42", decoded.matricNumber);
+    TEST_ASSERT_EQUAL_PTR(frame + 2, decoded.signedData);
+    TEST_ASSERT_EQUAL(sizeof(frame) - 2 - BEACON_MAC_BYTES, decoded.signedLength);
+    TEST_ASSERT_EQUAL_PTR(frame + sizeof(frame) - BEACON_MAC_BYTES, decoded.mac);
+
+    // No matric number, or someone else's company ID.
+    TEST_ASSERT_FALSE(decodeMarkFrame(frame, 2 + 1 + 4 + 4 + BEACON_MAC_BYTES, decoded));
+    frame[0] = 0x4C;
+    TEST_ASSERT_FALSE(decodeMarkFrame(frame, sizeof(frame), decoded));
+}
+
+void test_session_frame_fits_advertisement()
+{
+    SessionFrame frame;
+    frame.generation = 1;
+    frame.index = 0;
+    frame.count = 1;
+    frame.sessionTag = 0x12345678;
+    frame.minutesToExpiry = BEACON_EXPIRY_UNKNOWN;
+    frame.courseCode = makeWireString("A VERY LONG COURSE CODE THAT OVERFLOWS");
+    uint8_t out[64];
+    TEST_ASSERT_EQUAL(BEACON_MANUFACTURER_MAX, encodeSessionFrame(frame, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_HEX8(BEACON_FRAME_SESSION, out[2]);
+}
+
+void test_shard_entry_frame_round_trip()
+{
+    uint8_t entry[JOURNAL_ENTRY_MAX_BYTES];
+    size_t entryLength = encodeJournalMark(sampleMark(), entry, sizeof(entry));
+    TEST_ASSERT_LESS_OR_EQUAL(SHARD_ENTRY_MAX_BYTES, entryLength);
+
+    ShardFrame frame = {};
+    frame.type = SHARD_FRAME_ENTRY;
+    frame.shardId = 3;
+    frame.incarnation = 0xCAFEF00D;
+    frame.sequence = 42;
+    frame.entry = entry;
+    frame.entryLength = entryLength;
+    uint8_t out[SHARD_FRAME_MAX_BYTES];
+    size_t length = encodeShardFrame(frame, out, sizeof(out));
+    TEST_ASSERT_EQUAL(SHARD_HEADER_BYTES + entryLength, length);
+    memset(out + length, 0xAB, SHARD_MAC_BYTES);
+
+    ShardFrame decoded;
+    size_t signedLength = 0;
+    TEST_ASSERT_TRUE(decodeShardFrame(out, length + SHARD_MAC_BYTES, decoded, signedLength));
+    TEST_ASSERT_EQUAL(length, signedLength);
+    TEST_ASSERT_EQUAL(SHARD_FRAME_ENTRY, decoded.type);
+    TEST_ASSERT_EQUAL(3, decoded.shardId);
+    TEST_ASSERT_EQUAL_HEX32(0xCAFEF00D, decoded.incarnation);
+    TEST_ASSERT_EQUAL_UINT32(42, decoded.sequence);
+    TEST_ASSERT_EQUAL(entryLength, decoded.entryLength);
+    TEST_ASSERT_EQUAL_MEMORY(entry, decoded.entry, entryLength);
+
+    // No room for the MAC.
+    TEST_ASSERT_EQUAL(0, encodeShardFrame(frame, out, length));
+}
+
+void test_shard_control_frames()
+{
+    ShardFrame frame = {};
+    frame.type = SHARD_FRAME_RESEND;
+    frame.shardId = 1;
+    frame.sequence = 7;
+    frame.targetShard = 2;
+    frame.targetIncarnation = 0x01020304;
+    uint8_t out[SHARD_FRAME_MAX_BYTES] = {};
+    size_t length = encodeShardFrame(frame, out, sizeof(out));
+    TEST_ASSERT_EQUAL(SHARD_HEADER_BYTES + 5, length);
+
+    ShardFrame decoded;
+    size_t signedLength = 0;
+    TEST_ASSERT_TRUE(decodeShardFrame(out, length + SHARD_MAC_BYTES, decoded, signedLength));
+    TEST_ASSERT_EQUAL(2, decoded.targetShard);
+    TEST_ASSERT_EQUAL_HEX32(0x01020304, decoded.targetIncarnation);
+
+    // A heartbeat's payload is exactly the oldest retained sequence.
+    frame.type = SHARD_FRAME_HEARTBEAT;
+    frame.oldestSequence = 5;
+    length = encodeShardFrame(frame, out, sizeof(out));
+    TEST_ASSERT_TRUE(decodeShardFrame(out, length + SHARD_MAC_BYTES, decoded, signedLength));
+    TEST_ASSERT_EQUAL_UINT32(5, decoded.oldestSequence);
+    TEST_ASSERT_FALSE(decodeShardFrame(out, length + SHARD_MAC_BYTES + 1, decoded, signedLength));
+
+    // Unknown shards and versions.
+    out[2] = SHARD_MAX_COUNT;
+    TEST_ASSERT_FALSE(decodeShardFrame(out, length + SHARD_MAC_BYTES, decoded, signedLength));
+    out[2] = 1;
+    out[0] = SHARD_FRAME_VERSION + 1;
+    TEST_ASSERT_FALSE(decodeShardFrame(out, length + SHARD_MAC_BYTES, decoded, signedLength));
+}
+
+void test_shard_for_matric_spreads_students()
+{
+    unsigned counts[4] = {};
+    char matric[RECORD_MATRIC_MAX_LEN + 1];
+    for (int i = 0; i < 1000; ++i)
+    {
+        int length = snprintf(matric, sizeof(matric), "CSC/2019/%05d", i);
+        ++counts[shardForMatric(matric, length, 4)];
+    }
+    for (unsigned count : counts)
+    {
+        TEST_ASSERT_GREATER_THAN(150, count);
+    }
+    TEST_ASSERT_EQUAL(0, shardForMatric(matric, strlen(matric), 1));
+}
+
+void test_export_block_header()
+{
+    uint8_t block[64];
+    size_t count = 99;
+    TEST_ASSERT_EQUAL(10, encodeExportBlock(0x12345678, records, 0, 300, 300, block, sizeof(block), count));
+    TEST_ASSERT_EQUAL(0, count);
+    // Version, the session tag, then varints 300, 300, 0.
+    const uint8_t expected[] = {EXPORT_FORMAT_VERSION, 0x78, 0x56, 0x34, 0x12, 0xAC, 0x02, 0xAC, 0x02, 0x00};
+    TEST_ASSERT_EQUAL_MEMORY(expected, block, sizeof(expected));
+}
+
+void test_export_block_stops_at_capacity()
+{
+    SessionSlot *slot = claimSession("s1", 2);
+    char matric[RECORD_MATRIC_MAX_LEN + 1];
+    for (size_t i = 0; i < EXPORT_MAX_RECORDS + 4; ++i)
+    {
+        snprintf(matric, sizeof(matric), "CSC/2019/%05u", static_cast<unsigned>(i));
+        TEST_ASSERT_TRUE(addMark(*slot, matric));
+    }
+    static AttendanceRecord copy[EXPORT_MAX_RECORDS + 4];
+    RecordCursor cursor = recordCursorAt(slot->attendances, 0);
+    size_t copied = 0;
+    while (const AttendanceRecord *record = nextRecord(slot->attendances, cursor))
+    {
+        copy[copied++] = *record;
+    }
+
+    uint8_t block[512];
+    size_t count = 0;
+    TEST_ASSERT_GREATER_THAN(0, encodeExportBlock(1, copy, copied, 0, copied, block, sizeof(block), count));
+    TEST_ASSERT_EQUAL(EXPORT_MAX_RECORDS, count);
+
+    size_t small = encodeExportBlock(1, copy, copied, 0, copied, block, 40, count);
+    TEST_ASSERT_LESS_OR_EQUAL(40, small);
+    TEST_ASSERT_GREATER_THAN(0, count);
+    TEST_ASSERT_LESS_THAN(EXPORT_MAX_RECORDS, count);
+
+    TEST_ASSERT_EQUAL(0, encodeExportBlock(1, copy, copied, 0, copied, block, 8, count));
+}
+
+void test_json_writer_escapes_and_nests()
+{
+    char buffer[128];
+    JsonWriter writer(buffer, sizeof(buffer));
+    writer.beginObject();
+    writer.key("name");
+    writer.value("say \"hi\"\n");
+    writer.key("seq");
+    writer.value(42UL);
+    writer.key("list");
+    writer.beginArray();
+    writer.value(1UL);
+    writer.value(2UL);
+    writer.endArray();
+    writer.endObject();
+
+    const char *expected = "{\"name\":\"say \\\"hi\\\"\\n\",\"seq\":42,\"list\":[1,2]}";
+    TEST_ASSERT_FALSE(writer.full());
+    TEST_ASSERT_EQUAL(strlen(expected), writer.length());
+    TEST_ASSERT_EQUAL_MEMORY(expected, buffer, writer.length());
+}
+
+void test_json_writer_rewinds_to_valid_json()
+{
+    char buffer[24];
+    JsonWriter writer(buffer, sizeof(buffer));
+    writer.beginArray();
+    writer.value("first");
+    JsonWriter::Mark last = writer.mark();
+    writer.value("this one does not fit");
+    TEST_ASSERT_TRUE(writer.full());
+
+    writer.rewind(last);
+    TEST_ASSERT_FALSE(writer.full());
+    writer.endArray();
+    const char *expected = "[\"first\"]";
+    TEST_ASSERT_EQUAL(strlen(expected), writer.length());
+    TEST_ASSERT_EQUAL_MEMORY(expected, buffer, writer.length());
+}
+
+void test_create_session_request()
+{
+    const char *json = "{\"sessionId\":\"s1\",\"courseCode\":\"CSC 401\",\"courseName\":\"Compilers\","
+                       "\"expiryTimestamp\":1760003600}";
+    CreateSessionRequest request;
+    TEST_ASSERT_EQUAL(WRITE_STATUS_OK, decodeCreateSessionRequest(json, strlen(json), request));
+    TEST_ASSERT_EQUAL_STRING("s1", request.sessionId);
+    TEST_ASSERT_EQUAL(2, request.sessionIdLength);
+    TEST_ASSERT_EQUAL_STRING("Compilers", request.courseName);
+    TEST_ASSERT_EQUAL(1760003600UL, request.expiryTimestamp);
+
+    const char *noId = "{\"courseCode\":\"CSC 401\"}";
+    TEST_ASSERT_EQUAL(WRITE_STATUS_INVALID_FIELD, decodeCreateSessionRequest(noId, strlen(noId), request));
+    TEST_ASSERT_EQUAL(WRITE_STATUS_MALFORMED, decodeCreateSessionRequest("{\"sessionId\":", 13, request));
+}
+
+void test_mark_request_accepts_legacy_name()
+{
+    const char *json = "{\"sessionId\":\"s1\",\"name\":\"Adaeze\",\"matricNumber\":\"M1\",\"timestamp\":7}";
+    MarkRequest request;
+    TEST_ASSERT_TRUE(decodeMarkRequest(json, strlen(json), request));
+    TEST_ASSERT_EQUAL_STRING("Adaeze", request.name);
+
+    MarkAttendanceMessage message = markMessage(request);
+    assertWireString("s1", message.sessionId);
+    assertWireString("M1", message.matricNumber);
+    TEST_ASSERT_EQUAL_UINT32(7, message.timestamp);
+}
+
+void test_mark_request_keeps_overlong_matric_invalid()
+{
+    char json[160];
+    snprintf(json, sizeof(json), "{\"sessionId\":\"s1\",\"matricNumber\":\"%0*d\"}", RECORD_MATRIC_MAX_LEN + 5, 0);
+    MarkRequest request;
+    TEST_ASSERT_TRUE(decodeMarkRequest(json, strlen(json), request));
+    TEST_ASSERT_EQUAL(RECORD_MATRIC_MAX_LEN + 1, strlen(request.matricNumber));
+}
+
+void test_page_request_since_and_cursor()
+{
+    PageRequest request;
+    const char *since = "{\"sessionId\":\"s1\",\"since\":12}";
+    TEST_ASSERT_TRUE(decodePageRequest(since, strlen(since), request));
+    TEST_ASSERT_EQUAL(12, request.offset);
+
+    const char *cursor = "{\"sessionId\":\"s1\",\"cursor\":5}";
+    TEST_ASSERT_TRUE(decodePageRequest(cursor, strlen(cursor), request));
+    TEST_ASSERT_EQUAL(5, request.offset);
+    TEST_ASSERT_EQUAL_STRING("s1", request.sessionId);
+
+    TEST_ASSERT_FALSE(decodePageRequest("not json", 8, request));
+}
+
+void test_time_sync_binary_and_json()
+{
+    uint32_t epoch = 0;
+    const uint8_t binary[] = {0x00, 0xE1, 0xE6, 0x68};
+    TEST_ASSERT_TRUE(decodeTimeSync(binary, sizeof(binary), epoch));
+    TEST_ASSERT_EQUAL_HEX32(0x68E6E100, epoch);
+
+    const char *json = "{\"timestamp\":1760000000}";
+    TEST_ASSERT_TRUE(decodeTimeSync(reinterpret_cast<const uint8_t *>(json), strlen(json), epoch));
+    TEST_ASSERT_EQUAL_UINT32(1760000000, epoch);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_mark_round_trip);
+    RUN_TEST(test_mark_rejects_bad_framing);
+    RUN_TEST(test_batch_walks_each_record);
+    RUN_TEST(test_store_rejects_duplicate_matric);
+    RUN_TEST(test_store_claim_find_release);
+    RUN_TEST(test_store_fills_every_slot);
+    RUN_TEST(test_records_iterate_in_order);
+    RUN_TEST(test_journal_round_trip);
+    RUN_TEST(test_journal_session_entry);
+    RUN_TEST(test_clock_ignores_later_client_timestamps);
+    RUN_TEST(test_clock_skewed_mark_then_sync);
+    RUN_TEST(test_mark_frame_decode);
+    RUN_TEST(test_session_frame_fits_advertisement);
+    RUN_TEST(test_shard_entry_frame_round_trip);
+    RUN_TEST(test_shard_control_frames);
+    RUN_TEST(test_shard_for_matric_spreads_students);
+    RUN_TEST(test_export_block_header);
+    RUN_TEST(test_export_block_stops_at_capacity);
+    RUN_TEST(test_json_writer_escapes_and_nests);
+    RUN_TEST(test_json_writer_rewinds_to_valid_json);
+    RUN_TEST(test_create_session_request);
+    RUN_TEST(test_mark_request_accepts_legacy_name);
+    RUN_TEST(test_mark_request_keeps_overlong_matric_invalid);
+    RUN_TEST(test_page_request_since_and_cursor);
+    RUN_TEST(test_time_sync_binary_and_json);
+    return UNITY_END();
+}
@@ -0,0 +1,313 @@
+#!/usr/bin/env python3
+"""Lecture-hall load generator for the attendance beacon.
+
+Drives the beacon's GATT service from a Linux/BlueZ host the way a class of
+phones would: a lecturer connection creates a session, then one central per
+Bluetooth adapter marks students at a controlled rate. BlueZ holds a single
+connection per adapter to a given peer, so N concurrent centrals need N
+adapters (USB dongles work); --mode reconnect instead has each central
+connect, mark and disconnect per student, like the app does.
+
+Reports write-ack latency (write to write-status notification) as p50/p99,
+marks per second and statuses, then times full retrieval of sessions of
+each --session-sizes size through the JSON page and columnar export reads.
+
+    pip install -r requirements.txt
+    ./loadgen.py --adapters hci0,hci1,hci2 --students 300 --rate 20
+"""
+
+import argparse
+import asyncio
+import json
+import struct
+import time
+import uuid
+from collections import Counter
+
+from bleak import BleakClient, BleakScanner
+
+DEVICE_NAME = "ESP32-Attendance"
+SERVICE_UUID = "4fafc201-1fb5-459e-8fcc-c5c9c331914b"
+CHAR_CREATE = "beb5483e-36e1-4688-b7f5-ea07361b26a8"
+CHAR_PAGE_REQUEST = "beb5483e-36e1-4688-b7f5-ea07361b26ac"
+CHAR_PAGE = "beb5483e-36e1-4688-b7f5-ea07361b26ad"
+CHAR_MARK_BINARY = "beb5483e-36e1-4688-b7f5-ea07361b26ae"
+CHAR_TIME_SYNC = "beb5483e-36e1-4688-b7f5-ea07361b26af"
+CHAR_MARK_BATCH = "beb5483e-36e1-4688-b7f5-ea07361b26b1"
+CHAR_WRITE_STATUS = "beb5483e-36e1-4688-b7f5-ea07361b26b2"
+CHAR_EXPORT = "beb5483e-36e1-4688-b7f5-ea07361b26b3"
+
+# Mirrors wire_format.h and write_status.h in esp32/lib/attendance_core.
+WIRE_FORMAT_VERSION = 1
+WIRE_MATRIC_BYTES = 16
+WIRE_BATCH_MAX_RECORDS = 32
+OP_CREATE_SESSION = 1
+OP_MARK = 2
+STATUS_NAMES = {
+    0: "ok",
+    1: "duplicate",
+    16: "malformed",
+    17: "invalid-field",
+    18: "unknown-session",
+    19: "expired",
+    32: "rate-limited",
+    33: "sessions-full",
+    34: "storage-full",
+    35: "restoring",
+}
+ACK_TIMEOUT = 5.0
+
+
+def encode_record(name, matric, timestamp):
+    name_bytes = name.encode()[:255]
+    matric_bytes = matric.encode()[:WIRE_MATRIC_BYTES].ljust(WIRE_MATRIC_BYTES, b"\0")
+    return bytes([len(name_bytes)]) + name_bytes + matric_bytes + struct.pack("<I", timestamp)
+
+
+def encode_mark(session_id, name, matric, timestamp):
+    sid = session_id.encode()
+    return bytes([WIRE_FORMAT_VERSION, len(sid)]) + sid + encode_record(name, matric, timestamp)
+
+
+def encode_batch(session_id, students, timestamp):
+    sid = session_id.encode()
+    body = b"".join(encode_record(name, matric, timestamp) for name, matric in students)
+    return bytes([WIRE_FORMAT_VERSION, len(sid)]) + sid + bytes([len(students)]) + body
+
+
+def export_block_count(block):
+    """Record count of an export block (see export_format.h)."""
+    pos = 1
+    fields = []
+    while len(fields) < 3:
+        value = shift = 0
+        while True:
+            byte = block[pos]
+            pos += 1
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if byte < 0x80:
+                break
+        fields.append(value)
+    return fields[2]
+
+
+def percentile(samples, fraction):
+    if not samples:
+        return float("nan")
+    ordered = sorted(samples)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+
+
+class StatusChannel:
+    """Write-status notifications for one connection, matched to writes."""
+
+    def __init__(self):
+        self.waiters = []
+
+    def on_notify(self, _, data):
+        if len(data) != 2:
+            return
+        for operation, future in list(self.waiters):
+            if operation == data[0] and not future.done():
+                future.set_result(data[1])
+                self.waiters.remove((operation, future))
+                return
+
+    async def write(self, client, char_uuid, payload, operation):
+        future = asyncio.get_running_loop().create_future()
+        self.waiters.append((operation, future))
+        start = time.perf_counter()
+        await client.write_gatt_char(char_uuid, payload, response=True)
+        try:
+            status = await asyncio.wait_for(future, ACK_TIMEOUT)
+        except asyncio.TimeoutError:
+            self.waiters.remove((operation, future))
+            status = None
+        return status, time.perf_counter() - start
+
+
+async def find_beacon(address):
+    if address:
+        return address
+    device = await BleakScanner.find_device_by_name(DEVICE_NAME, timeout=15.0)
+    if device is None:
+        raise SystemExit(f"No {DEVICE_NAME} found")
+    return device.address
+
+
+async def open_client(address, adapter):
+    client = BleakClient(address, adapter=adapter)
+    await client.connect()
+    channel = StatusChannel()
+    await client.start_notify(CHAR_WRITE_STATUS, channel.on_notify)
+    return client, channel
+
+
+async def create_session(client, channel, course_code):
+    session_id = str(uuid.uuid4())
+    now = int(time.time())
+    await client.write_gatt_char(CHAR_TIME_SYNC, json.dumps({"timestamp": now}).encode(), response=True)
+    payload = json.dumps(
+        {
+            "sessionId": session_id,
+            "courseCode": course_code,
+            "courseName": "Load test",
+            "expiryTimestamp": now + 3 * 3600,
+        }
+    ).encode()
+    status, _ = await channel.write(client, CHAR_CREATE, payload, OP_CREATE_SESSION)
+    if status != 0:
+        raise SystemExit(f"Session create failed with status {status}")
+    return session_id
+
+
+async def run_marks(args, address, session_id):
+    """Marks args.students students at args.rate per second across centrals."""
+    latencies = []
+    statuses = Counter()
+    next_student = iter(range(args.students))
+    start = time.perf_counter()
+
+    async def mark(client, channel, index, started=None):
+        # Pace against the schedule, not the previous write, so slow acks
+        # show up as latency instead of silently lowering the offered load.
+        due = start + index / args.rate
+        await asyncio.sleep(max(0.0, due - time.perf_counter()))
+        payload = encode_mark(session_id, f"Student {index}", f"LG/{index:06d}", int(time.time()))
+        status, latency = await channel.write(client, CHAR_MARK_BINARY, payload, OP_MARK)
+        statuses[STATUS_NAMES.get(status, "no-ack" if status is None else str(status))] += 1
+        if status is not None:
+            latencies.append(time.perf_counter() - started if started else latency)
+
+    async def central(adapter):
+        if args.mode == "connection":
+            client, channel = await open_client(address, adapter)
+            try:
+                for index in next_student:
+                    await mark(client, channel, index)
+            finally:
+                await client.disconnect()
+            return
+        for index in next_student:
+            started = time.perf_counter() if args.count_connect else None
+            client, channel = await open_client(address, adapter)
+            try:
+                await mark(client, channel, index, started)
+            finally:
+                await client.disconnect()
+
+    await asyncio.gather(*(central(adapter) for adapter in args.adapters))
+    elapsed = time.perf_counter() - start
+    return {
+        "students": args.students,
+        "centrals": len(args.adapters),
+        "mode": args.mode,
+        "elapsedSeconds": round(elapsed, 3),
+        "marksPerSecond": round(statuses["ok"] / elapsed, 2) if elapsed > 0 else 0,
+        "ackLatencyMs": {
+            "p50": round(percentile(latencies, 0.50) * 1000, 1),
+            "p99": round(percentile(latencies, 0.99) * 1000, 1),
+            "max": round(max(latencies, default=float("nan")) * 1000, 1),
+        },
+        "statuses": dict(statuses),
+    }
+
+
+async def fill_session(client, session_id, size):
+    now = int(time.time())
+    for first in range(0, size, WIRE_BATCH_MAX_RECORDS):
+        students = [
+            (f"Student {i}", f"RT/{i:06d}") for i in range(first, min(size, first + WIRE_BATCH_MAX_RECORDS))
+        ]
+        await client.write_gatt_char(CHAR_MARK_BATCH, encode_batch(session_id, students, now), response=True)
+        # Stay inside the per-connection write rate limit.
+        await asyncio.sleep(0.25)
+
+
+async def time_retrieval(client, session_id, size):
+    request = json.dumps({"sessionId": session_id, "cursor": 0}).encode()
+
+    await client.write_gatt_char(CHAR_PAGE_REQUEST, request, response=True)
+    start = time.perf_counter()
+    pages = page_bytes = received = 0
+    while True:
+        raw = bytes(await client.read_gatt_char(CHAR_PAGE))
+        page = json.loads(raw)
+        pages += 1
+        page_bytes += len(raw)
+        received += len(page["attendances"])
+        if not page["attendances"] or page["next"] >= page["total"]:
+            break
+    page_seconds = time.perf_counter() - start
+
+    await client.write_gatt_char(CHAR_PAGE_REQUEST, request, response=True)
+    start = time.perf_counter()
+    blocks = export_bytes = 0
+    while True:
+        block = bytes(await client.read_gatt_char(CHAR_EXPORT))
+        blocks += 1
+        export_bytes += len(block)
+        if export_block_count(block) == 0:
+            break
+    export_seconds = time.perf_counter() - start
+
+    return {
+        "records": size,
+        "jsonPages": {"reads": pages, "bytes": page_bytes, "ms": round(page_seconds * 1000, 1), "records": received},
+        "export": {"reads": blocks, "bytes": export_bytes, "ms": round(export_seconds * 1000, 1)},
+    }
+
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--address", help="beacon address; scans for it by name if omitted")
+    parser.add_argument("--adapters", default="hci0", help="comma-separated adapters, one central each")
+    parser.add_argument("--students", type=int, default=100)
+    parser.add_argument("--rate", type=float, default=10.0, help="offered marks per second, all centrals")
+    parser.add_argument("--mode", choices=["connection", "reconnect"], default="connection")
+    parser.add_argument("--count-connect", action="store_true", help="in reconnect mode, time from connect")
+    parser.add_argument("--session-sizes", default="50,200,500", help="retrieval sizes, empty to skip")
+    parser.add_argument("--json", action="store_true", help="print the report as JSON")
+    args = parser.parse_args()
+    args.adapters = [adapter for adapter in args.adapters.split(",") if adapter]
+
+    address = await find_beacon(args.address)
+    lecturer, channel = await open_client(address, args.adapters[0])
+    try:
+        session_id = await create_session(lecturer, channel, "LOAD101")
+    finally:
+        await lecturer.disconnect()
+
+    report = {"marks": await run_marks(args, address, session_id), "retrieval": []}
+
+    sizes = [int(size) for size in args.session_sizes.split(",") if size]
+    if sizes:
+        lecturer, channel = await open_client(address, args.adapters[0])
+        try:
+            for size in sizes:
+                retrieval_session = await create_session(lecturer, channel, f"RT{size}")
+                await fill_session(lecturer, retrieval_session, size)
+                report["retrieval"].append(await time_retrieval(lecturer, retrieval_session, size))
+        finally:
+            await lecturer.disconnect()
+
+    if args.json:
+        print(json.dumps(report, indent=2))
+        return
+    marks = report["marks"]
+    print(f"{marks['students']} students over {marks['centrals']} central(s), {marks['mode']} mode")
+    print(f"  {marks['marksPerSecond']} marks/s accepted in {marks['elapsedSeconds']} s")
+    latency = marks["ackLatencyMs"]
+    print(f"  write-ack latency p50 {latency['p50']} ms, p99 {latency['p99']} ms, max {latency['max']} ms")
+    print(f"  statuses: {marks['statuses']}")
+    for row in report["retrieval"]:
+        pages, export = row["jsonPages"], row["export"]
+        print(
+            f"  retrieve {row['records']:>5} records: JSON {pages['ms']} ms / {pages['bytes']} B,"
+            f" export {export['ms']} ms / {export['bytes']} B"
+        )
+
+
+if __name__ == "__main__":
+    asyncio.run(main())
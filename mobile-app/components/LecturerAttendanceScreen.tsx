@@ -1,5 +1,5 @@
 import { formatDistanceToNow } from "date-fns";
-import React, { useCallback, useEffect, useState } from "react";
+import React, { useCallback, useEffect, useRef, useState } from "react";
 import {
   KeyboardAvoidingView,
   Platform,
@@ -19,19 +19,27 @@ import {
 } from "react-native-paper";
 import Share from "react-native-share";
 
+import { readSessionExport } from "../utils/export";
 import {
   formatDateTime,
   generateStudentAttendanceFilename,
   now,
 } from "../utils/helpers";
 import { requestBlePermissions } from "../utils/permission";
+import { decodeAttendanceDelta } from "../utils/protocol";
+import { parseBeaconName } from "../utils/shard";
 import LogoutButton from "./LogoutButton";
 
 const SCAN_TIMEOUT = 10000;
-const DEVICE_NAME = "ESP32-Attendance";
 const SERVICE_UUID = "4fafc201-1fb5-459e-8fcc-c5c9c331914b";
 const CHAR_UUID_CREATE_ATTENDANCE = "beb5483e-36e1-4688-b7f5-ea07361b26a8";
-const CHAR_UUID_RETRIEVE_ATTENDANCES = "beb5483e-36e1-4688-b7f5-ea07361b26aa";
+const CHAR_UUID_RETRIEVE_SESSIONS = "beb5483f-36e1-4688-b7f5-ea07361b26ab";
+const CHAR_UUID_ATTENDANCE_PAGE_REQUEST =
+  "beb5483e-36e1-4688-b7f5-ea07361b26ac";
+const CHAR_UUID_TIME_SYNC = "beb5483e-36e1-4688-b7f5-ea07361b26af";
+const CHAR_UUID_ATTENDANCE_DELTAS = "beb5483e-36e1-4688-b7f5-ea07361b26b0";
+const CHAR_UUID_WRITE_STATUS = "beb5483e-36e1-4688-b7f5-ea07361b26b2";
+const CHAR_UUID_ATTENDANCE_EXPORT = "beb5483e-36e1-4688-b7f5-ea07361b26b3";
 
 interface AttendanceRecord {
   studentName: string;
@@ -39,6 +47,14 @@ interface AttendanceRecord {
   timestamp: number;
 }
 
+// An entry of the beacon's session list.
+interface BeaconSession {
+  sessionId: string;
+  courseCode: string;
+  courseName: string;
+  expiryTimestamp: number;
+}
+
 interface AttendanceSession {
   sessionId: string;
   courseCode: string;
@@ -87,6 +103,11 @@ const LecturerAttendanceScreen: React.FC<LecturerAttendanceScreenProps> = ({
     AttendanceSession[]
   >([]);
   const [isExporting, setIsExporting] = useState<string | null>(null);
+  const lastDeltaSequence = useRef<number | null>(null);
+  const isRetrieving = useRef(false);
+  const retrieveAgain = useRef(false);
+  const attendanceSessionsRef = useRef(attendanceSessions);
+  attendanceSessionsRef.current = attendanceSessions;
 
   useEffect(() => {
     const subscription = device?.onDisconnected(() => {
@@ -143,8 +164,9 @@ const LecturerAttendanceScreen: React.FC<LecturerAttendanceScreenProps> = ({
         return;
       }
 
-      if (scannedDevice && scannedDevice.name === DEVICE_NAME) {
-        console.log("Found target device:", DEVICE_NAME);
+      // Any shard of a sharded hall holds the merged attendance list.
+      if (scannedDevice && parseBeaconName(scannedDevice.name)) {
+        console.log("Found target device:", scannedDevice.name);
         bleManager.stopDeviceScan();
         clearTimeout(scanTimeout);
 
@@ -154,8 +176,19 @@ const LecturerAttendanceScreen: React.FC<LecturerAttendanceScreenProps> = ({
           .then((connectedDevice) =>
             connectedDevice.discoverAllServicesAndCharacteristics()
           )
-          .then((discoveredDevice) => {
+          .then(async (discoveredDevice) => {
             console.log("Connected and discovered services");
+            // The beacon stamps attendance and expires sessions on its own
+            // clock, which is set from the lecturer's phone.
+            await discoveredDevice
+              .writeCharacteristicWithoutResponseForService(
+                SERVICE_UUID,
+                CHAR_UUID_TIME_SYNC,
+                btoa(JSON.stringify({ timestamp: Math.floor(now()) }))
+              )
+              .catch((syncError) => {
+                console.error("Time sync error:", syncError);
+              });
             setDevice(discoveredDevice);
             setConnectionState("connected");
             showToast("Connected to ESP32-Attendance", "success");
@@ -170,58 +203,74 @@ const LecturerAttendanceScreen: React.FC<LecturerAttendanceScreenProps> = ({
   }, [bleManager, connectionState, resetConnection, showToast]);
 
   const retrieveAttendances = useCallback(async () => {
+    // Every export read moves the same cursor on the beacon, so a resync
+    // asked for while a read is running waits for it and then runs once.
+    if (isRetrieving.current) {
+      retrieveAgain.current = true;
+      return;
+    }
+    isRetrieving.current = true;
     setIsFetchingSessions(true);
     try {
       // Fetch sessions from the local database
       const localSessions = await fetchAttendanceSessions(lecturerEmail);
 
-      // If connected to the device, try to update with the latest records
+      // If connected to the device, try to update with the latest records.
+      // The combined attendances read is cut off at one attribute, so each
+      // session is read in full from the export characteristic instead, one
+      // at a time since they share the connection's cursor.
       if (device && connectionState === "connected") {
         try {
           const characteristic = await device.readCharacteristicForService(
             SERVICE_UUID,
-            CHAR_UUID_RETRIEVE_ATTENDANCES
+            CHAR_UUID_RETRIEVE_SESSIONS
           );
           if (characteristic.value) {
-            const decodedValue = atob(characteristic.value);
-            const deviceData = JSON.parse(decodedValue);
-            console.log("Data from server:", deviceData);
+            const deviceSessions: BeaconSession[] = JSON.parse(
+              atob(characteristic.value)
+            );
+            console.log("Sessions from device:", deviceSessions);
             console.log("Data from local database:", localSessions);
 
-            const updatedSessions = await Promise.all(
-              Object.entries(deviceData).map(
-                async ([sessionId, sessionData]: [string, any]) => {
-                  const localSession = localSessions.find(
-                    (s) => s.sessionId === sessionId
-                  );
-                  const updatedRecords: AttendanceRecord[] =
-                    sessionData.attendances.map((record: any) => ({
-                      studentName: record.name,
-                      matricNumber: record.matricNumber,
-                      timestamp: record.timestamp,
-                    }));
-
-                  // Update the local database with new records
-                  await saveAttendanceSession({
-                    sessionId,
-                    lecturerEmail,
-                    courseCode: sessionData.courseCode,
-                    courseName: sessionData.courseName,
-                    records: updatedRecords,
-                  });
-
-                  return {
-                    sessionId,
-                    courseCode: sessionData.courseCode,
-                    courseName: sessionData.courseName,
-                    createdAt: localSession
-                      ? localSession.createdAt
-                      : Date.now(),
-                    records: updatedRecords,
-                  };
-                }
-              )
-            );
+            const updatedSessions: AttendanceSession[] = [];
+            for (const sessionData of deviceSessions) {
+              const { sessionId } = sessionData;
+              const localSession = localSessions.find(
+                (s) => s.sessionId === sessionId
+              );
+              const exported = await readSessionExport(
+                device,
+                SERVICE_UUID,
+                CHAR_UUID_ATTENDANCE_PAGE_REQUEST,
+                CHAR_UUID_ATTENDANCE_EXPORT,
+                CHAR_UUID_WRITE_STATUS,
+                sessionId
+              );
+              const updatedRecords: AttendanceRecord[] = exported.map(
+                (record) => ({
+                  studentName: record.studentName,
+                  matricNumber: record.matricNumber,
+                  timestamp: record.timestamp,
+                })
+              );
+
+              // Update the local database with new records
+              await saveAttendanceSession({
+                sessionId,
+                lecturerEmail,
+                courseCode: sessionData.courseCode,
+                courseName: sessionData.courseName,
+                records: updatedRecords,
+              });
+
+              updatedSessions.push({
+                sessionId,
+                courseCode: sessionData.courseCode,
+                courseName: sessionData.courseName,
+                createdAt: localSession ? localSession.createdAt : Date.now(),
+                records: updatedRecords,
+              });
+            }
 
             // Merge updated sessions with local sessions
             const mergedSessions = [
@@ -254,8 +303,13 @@ const LecturerAttendanceScreen: React.FC<LecturerAttendanceScreenProps> = ({
       console.error("Retrieve attendances error:", error);
       showToast("Failed to retrieve attendances", "error");
     } finally {
+      isRetrieving.current = false;
       setIsFetchingSessions(false);
     }
+    if (retrieveAgain.current) {
+      retrieveAgain.current = false;
+      retrieveAttendances();
+    }
   }, [
     device,
     connectionState,
@@ -265,6 +319,80 @@ const LecturerAttendanceScreen: React.FC<LecturerAttendanceScreenProps> = ({
     saveAttendanceSession,
   ]);
 
+  // After one full export on connect, new marks arrive as delta
+  // notifications. A gap in the sequence means deltas were missed, so export
+  // every session again.
+  useEffect(() => {
+    if (!device || connectionState !== "connected") {
+      return;
+    }
+
+    lastDeltaSequence.current = null;
+    retrieveAttendances();
+
+    const subscription = device.monitorCharacteristicForService(
+      SERVICE_UUID,
+      CHAR_UUID_ATTENDANCE_DELTAS,
+      (error, characteristic) => {
+        if (error || !characteristic?.value) {
+          console.log("Attendance delta stream stopped:", error);
+          return;
+        }
+
+        const delta = decodeAttendanceDelta(characteristic.value);
+        if (!delta) {
+          console.error("Malformed attendance delta");
+          return;
+        }
+
+        const previous = lastDeltaSequence.current;
+        lastDeltaSequence.current = delta.sequence;
+        if (previous !== null && delta.sequence !== previous + 1) {
+          console.log("Missed attendance deltas, exporting again");
+          retrieveAttendances();
+          return;
+        }
+
+        const record: AttendanceRecord = {
+          studentName: delta.studentName,
+          matricNumber: delta.matricNumber,
+          timestamp: delta.timestamp,
+        };
+        const session = attendanceSessionsRef.current.find(
+          (s) => s.sessionId === delta.sessionId
+        );
+        if (
+          !session ||
+          session.records.some(
+            (existing) => existing.matricNumber === record.matricNumber
+          )
+        ) {
+          return;
+        }
+
+        saveAttendanceSession({
+          sessionId: session.sessionId,
+          lecturerEmail,
+          courseCode: session.courseCode,
+          courseName: session.courseName,
+          records: [record],
+        });
+        setAttendanceSessions((sessions) =>
+          sessions.map((s) =>
+            s.sessionId === delta.sessionId
+              ? { ...s, records: [...s.records, record] }
+              : s
+          )
+        );
+      }
+    );
+
+    return () => subscription.remove();
+    // The callbacks are recreated on every parent render; the stream only
+    // needs restarting when the connection changes.
+    // eslint-disable-next-line react-hooks/exhaustive-deps
+  }, [device, connectionState]);
+
   const createAttendanceSession = useCallback(() => {
     if (!device || connectionState !== "connected") {
       showToast("Device not connected", "error");
@@ -18,13 +18,31 @@ import {
 } from "react-native-paper";
 import { now } from "../utils/helpers";
 import { requestBlePermissions } from "../utils/permission";
+import {
+  WriteOperation,
+  WriteStatus,
+  isWriteAccepted,
+  isWriteRetryable,
+} from "../utils/protocol";
+import { parseBeaconName, shardForMatric } from "../utils/shard";
+import { writeWithStatus } from "../utils/writeStatus";
 import LogoutButton from "./LogoutButton";
 
 const SCAN_TIMEOUT = 10000;
-const DEVICE_NAME = "ESP32-Attendance";
+// In a sharded hall, how long to look for this student's own beacon before
+// settling for the strongest one in range.
+const SHARD_FALLBACK_MS = 3000;
 const SERVICE_UUID = "4fafc201-1fb5-459e-8fcc-c5c9c331914b";
 const CHAR_UUID_MARK_ATTENDANCE = "beb5483e-36e1-4688-b7f5-ea07361b26a9";
 const CHAR_UUID_RETRIEVE_SESSIONS = "beb5483f-36e1-4688-b7f5-ea07361b26ab";
+const CHAR_UUID_WRITE_STATUS = "beb5483e-36e1-4688-b7f5-ea07361b26b2";
+
+const MARK_REJECTION_MESSAGES: Record<number, string> = {
+  [WriteStatus.Malformed]: "The beacon could not read this request",
+  [WriteStatus.InvalidField]: "Your matric number was rejected",
+  [WriteStatus.UnknownSession]: "This session no longer exists",
+  [WriteStatus.Expired]: "This session has expired",
+};
 
 interface AttendanceSession {
   sessionId: string;
@@ -160,6 +178,11 @@ const StudentAttendanceScreen: React.FC<StudentAttendanceScreenProps> = ({
       showToast("Scan timed out. No device found.", "error");
     }, SCAN_TIMEOUT);
 
+    // Every shard holds every session, so any beacon can take the mark; the
+    // student's own shard is preferred to spread the hall's load.
+    const scanStarted = Date.now();
+    let fallback: Device | null = null;
+
     bleManager.startDeviceScan(null, null, (error, scannedDevice) => {
       if (error) {
         console.error("Scan error:", error);
@@ -169,13 +192,31 @@ const StudentAttendanceScreen: React.FC<StudentAttendanceScreenProps> = ({
         return;
       }
 
-      if (scannedDevice && scannedDevice.name === DEVICE_NAME) {
-        console.log("Found target device:", DEVICE_NAME);
+      const beacon = parseBeaconName(scannedDevice?.name);
+      if (scannedDevice && beacon) {
+        const preferred =
+          beacon.shard === shardForMatric(matricNumber, beacon.count);
+        if (
+          !preferred &&
+          (!fallback ||
+            (scannedDevice.rssi ?? -127) > (fallback.rssi ?? -127))
+        ) {
+          fallback = scannedDevice;
+        }
+        const target = preferred ? scannedDevice : fallback;
+        if (
+          !target ||
+          (!preferred && Date.now() - scanStarted < SHARD_FALLBACK_MS)
+        ) {
+          return;
+        }
+
+        console.log("Found target device:", target.name);
         bleManager.stopDeviceScan();
         clearTimeout(scanTimeout);
 
         setConnectionState("connecting");
-        scannedDevice
+        target
           .connect({ requestMTU: 512 })
           .then((connectedDevice) =>
             connectedDevice.discoverAllServicesAndCharacteristics()
@@ -197,18 +238,27 @@ const StudentAttendanceScreen: React.FC<StudentAttendanceScreenProps> = ({
   }, [
     bleManager,
     connectionState,
+    matricNumber,
     resetConnection,
     showToast,
     retrieveAvailableSessions,
   ]);
 
   useEffect(() => {
+    // The beacon drops student connections shortly after a mark is accepted
+    // and after a period of inactivity, so a disconnect here is routine.
+    const subscription = device?.onDisconnected(() => {
+      console.log("Device disconnected");
+      resetConnection();
+    });
+
     return () => {
       console.log("Component unmounting, cleaning up BLE");
+      subscription?.remove();
       bleManager.stopDeviceScan();
       device?.cancelConnection();
     };
-  }, [bleManager, device]);
+  }, [bleManager, device, resetConnection]);
 
   const markAttendance = useCallback(
     async (session: AttendanceSession) => {
@@ -226,12 +276,41 @@ const StudentAttendanceScreen: React.FC<StudentAttendanceScreenProps> = ({
       });
 
       try {
-        await device.writeCharacteristicWithoutResponseForService(
+        const status = await writeWithStatus(
+          device,
           SERVICE_UUID,
-          CHAR_UUID_MARK_ATTENDANCE,
-          btoa(data)
+          CHAR_UUID_WRITE_STATUS,
+          WriteOperation.Mark,
+          () =>
+            device.writeCharacteristicWithoutResponseForService(
+              SERVICE_UUID,
+              CHAR_UUID_MARK_ATTENDANCE,
+              btoa(data)
+            )
         );
 
+        // No status means a beacon without the status characteristic; keep
+        // the old optimistic behaviour for it.
+        if (status !== null && !isWriteAccepted(status)) {
+          if (isWriteRetryable(status)) {
+            showToast("The beacon is busy, please try again", "error");
+            return;
+          }
+          if (
+            status === WriteStatus.UnknownSession ||
+            status === WriteStatus.Expired
+          ) {
+            setAvailableSessions((prev) =>
+              prev.filter((s) => s.sessionId !== session.sessionId)
+            );
+          }
+          showToast(
+            MARK_REJECTION_MESSAGES[status] ?? "Attendance was rejected",
+            "error"
+          );
+          return;
+        }
+
         const markedAttendance: MarkedAttendance = { ...session, timestamp };
         await saveStudentAttendance(markedAttendance);
 
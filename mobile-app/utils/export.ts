@@ -0,0 +1,65 @@
+import { Device } from "react-native-ble-plx";
+import {
+  decodeExportBlock,
+  ExportedRecord,
+  WriteOperation,
+  WriteStatus,
+} from "./protocol";
+import { fnv1a } from "./shard";
+import { writeWithStatus } from "./writeStatus";
+
+// Reads every record of one session from the export characteristic. The
+// page request sets the cursor; each export read returns the next block and
+// advances it, until an empty block marks the end.
+//
+// The page request is only known to have landed once its write status
+// arrives: a dropped one leaves the cursor on the previous session. Every
+// block is also checked against the session's tag, so records of another
+// session are never returned under this one.
+export async function readSessionExport(
+  device: Device,
+  serviceUUID: string,
+  pageRequestUUID: string,
+  exportUUID: string,
+  statusUUID: string,
+  sessionId: string,
+  since = 0
+): Promise<ExportedRecord[]> {
+  const status = await writeWithStatus(
+    device,
+    serviceUUID,
+    statusUUID,
+    WriteOperation.PageRequest,
+    () =>
+      device.writeCharacteristicWithResponseForService(
+        serviceUUID,
+        pageRequestUUID,
+        btoa(JSON.stringify({ sessionId, since }))
+      )
+  );
+  if (status !== WriteStatus.Ok) {
+    throw new Error(`Page request for ${sessionId} failed: ${status}`);
+  }
+
+  const sessionTag = fnv1a(sessionId);
+  const records: ExportedRecord[] = [];
+  for (;;) {
+    const characteristic = await device.readCharacteristicForService(
+      serviceUUID,
+      exportUUID
+    );
+    const block = characteristic.value
+      ? decodeExportBlock(characteristic.value)
+      : null;
+    if (!block) {
+      throw new Error("Malformed export block");
+    }
+    if (block.sessionTag !== sessionTag) {
+      throw new Error(`Export block is not from session ${sessionId}`);
+    }
+    if (block.records.length === 0) {
+      return records;
+    }
+    records.push(...block.records);
+  }
+}
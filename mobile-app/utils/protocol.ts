@@ -0,0 +1,398 @@
+// Decoders for the beacon's binary characteristics. All integers are
+// little-endian, strings are length-prefixed UTF-8.
+
+export interface AttendanceDelta {
+  sequence: number;
+  sessionId: string;
+  studentName: string;
+  matricNumber: string;
+  timestamp: number;
+}
+
+const WIRE_FORMAT_VERSION = 1;
+const WIRE_MATRIC_BYTES = 16;
+
+export function base64ToBytes(value: string): Uint8Array {
+  const binary = atob(value);
+  const bytes = new Uint8Array(binary.length);
+  for (let i = 0; i < binary.length; i++) {
+    bytes[i] = binary.charCodeAt(i);
+  }
+  return bytes;
+}
+
+export function decodeUtf8(bytes: Uint8Array): string {
+  let result = "";
+  let i = 0;
+  while (i < bytes.length) {
+    const byte = bytes[i++];
+    let codePoint = byte;
+    if (byte >= 0xf0) {
+      codePoint =
+        ((byte & 0x07) << 18) |
+        ((bytes[i++] & 0x3f) << 12) |
+        ((bytes[i++] & 0x3f) << 6) |
+        (bytes[i++] & 0x3f);
+    } else if (byte >= 0xe0) {
+      codePoint =
+        ((byte & 0x0f) << 12) |
+        ((bytes[i++] & 0x3f) << 6) |
+        (bytes[i++] & 0x3f);
+    } else if (byte >= 0xc0) {
+      codePoint = ((byte & 0x1f) << 6) | (bytes[i++] & 0x3f);
+    }
+    result += String.fromCodePoint(codePoint);
+  }
+  return result;
+}
+
+export function readUint32(bytes: Uint8Array, offset: number): number {
+  return (
+    (bytes[offset] |
+      (bytes[offset + 1] << 8) |
+      (bytes[offset + 2] << 16) |
+      (bytes[offset + 3] << 24)) >>>
+    0
+  );
+}
+
+export function decodeAttendanceDelta(value: string): AttendanceDelta | null {
+  const bytes = base64ToBytes(value);
+  let offset = 0;
+
+  const readString = (): string | null => {
+    if (offset >= bytes.length) {
+      return null;
+    }
+    const length = bytes[offset++];
+    if (offset + length > bytes.length) {
+      return null;
+    }
+    const text = decodeUtf8(bytes.subarray(offset, offset + length));
+    offset += length;
+    return text;
+  };
+
+  if (bytes.length < 5) {
+    return null;
+  }
+  const sequence = readUint32(bytes, offset);
+  offset += 4;
+  if (bytes[offset++] !== WIRE_FORMAT_VERSION) {
+    return null;
+  }
+
+  const sessionId = readString();
+  const studentName = readString();
+  if (
+    sessionId === null ||
+    studentName === null ||
+    bytes.length - offset !== WIRE_MATRIC_BYTES + 4
+  ) {
+    return null;
+  }
+
+  const matricBytes = bytes.subarray(offset, offset + WIRE_MATRIC_BYTES);
+  const matricLength = matricBytes.indexOf(0);
+  const matricNumber = decodeUtf8(
+    matricLength === -1 ? matricBytes : matricBytes.subarray(0, matricLength)
+  );
+  offset += WIRE_MATRIC_BYTES;
+
+  return {
+    sequence,
+    sessionId,
+    studentName,
+    matricNumber,
+    timestamp: readUint32(bytes, offset),
+  };
+}
+
+// Mirrors esp32/lib/attendance_core/include/write_status.h.
+export const WriteOperation = {
+  CreateSession: 1,
+  Mark: 2,
+  MarkBatch: 3,
+  TimeSync: 4,
+  PageRequest: 5,
+} as const;
+
+export const WriteStatus = {
+  Ok: 0,
+  Duplicate: 1,
+  Malformed: 16,
+  InvalidField: 17,
+  UnknownSession: 18,
+  Expired: 19,
+  RateLimited: 32,
+  SessionsFull: 33,
+  StorageFull: 34,
+  Restoring: 35,
+} as const;
+
+export interface WriteStatusReport {
+  operation: number;
+  status: number;
+}
+
+export function decodeWriteStatus(value: string): WriteStatusReport | null {
+  const bytes = base64ToBytes(value);
+  if (bytes.length !== 2) {
+    return null;
+  }
+  return { operation: bytes[0], status: bytes[1] };
+}
+
+export function isWriteAccepted(status: number): boolean {
+  return status === WriteStatus.Ok || status === WriteStatus.Duplicate;
+}
+
+// Transient statuses are worth retrying; anything else is final.
+export function isWriteRetryable(status: number): boolean {
+  return status >= WriteStatus.RateLimited;
+}
+
+export interface ExportedRecord {
+  sequence: number;
+  studentName: string;
+  matricNumber: string;
+  timestamp: number;
+}
+
+export interface ExportBlock {
+  // FNV-1a of the session ID the block was read from.
+  sessionTag: number;
+  offset: number;
+  total: number;
+  records: ExportedRecord[];
+}
+
+const EXPORT_FORMAT_VERSION = 2;
+
+// Decodes one read of the export characteristic; the layout is documented in
+// esp32/lib/attendance_core/include/export_format.h. A block with no records
+// ends the export.
+export function decodeExportBlock(value: string): ExportBlock | null {
+  const bytes = base64ToBytes(value);
+  let offset = 0;
+
+  const readVarint = (): number | null => {
+    let result = 0;
+    let scale = 1;
+    while (offset < bytes.length) {
+      const byte = bytes[offset++];
+      result += (byte & 0x7f) * scale;
+      if (byte < 0x80) {
+        return result;
+      }
+      scale *= 128;
+    }
+    return null;
+  };
+
+  const readBytes = (length: number): Uint8Array | null => {
+    if (offset + length > bytes.length) {
+      return null;
+    }
+    const slice = bytes.subarray(offset, offset + length);
+    offset += length;
+    return slice;
+  };
+
+  if (bytes.length < 5 || bytes[offset++] !== EXPORT_FORMAT_VERSION) {
+    return null;
+  }
+  const sessionTag = readUint32(bytes, offset);
+  offset += 4;
+  const blockOffset = readVarint();
+  const total = readVarint();
+  const count = readVarint();
+  if (blockOffset === null || total === null || count === null) {
+    return null;
+  }
+  if (count === 0) {
+    return { sessionTag, offset: blockOffset, total, records: [] };
+  }
+
+  if (offset + 4 > bytes.length) {
+    return null;
+  }
+  const timestamps = [readUint32(bytes, offset)];
+  offset += 4;
+  for (let i = 1; i < count; i++) {
+    const zigzag = readVarint();
+    if (zigzag === null) {
+      return null;
+    }
+    const delta = zigzag % 2 === 0 ? zigzag / 2 : -(zigzag + 1) / 2;
+    timestamps.push(timestamps[i - 1] + delta);
+  }
+
+  const matricNumbers: string[] = [];
+  let previous = new Uint8Array(0);
+  for (let i = 0; i < count; i++) {
+    const header = readBytes(2);
+    const suffix = header ? readBytes(header[1]) : null;
+    if (!header || !suffix || header[0] > previous.length) {
+      return null;
+    }
+    const matric = new Uint8Array(header[0] + suffix.length);
+    matric.set(previous.subarray(0, header[0]));
+    matric.set(suffix, header[0]);
+    matricNumbers.push(decodeUtf8(matric));
+    previous = matric;
+  }
+
+  const dictionarySize = readVarint();
+  if (dictionarySize === null) {
+    return null;
+  }
+  const names: string[] = [];
+  for (let entry = 0; entry < dictionarySize; entry++) {
+    const length = readBytes(1);
+    const name = length ? readBytes(length[0]) : null;
+    if (!name) {
+      return null;
+    }
+    names.push(decodeUtf8(name));
+  }
+
+  const records: ExportedRecord[] = [];
+  for (let i = 0; i < count; i++) {
+    const index = readVarint();
+    if (index === null || index >= names.length) {
+      return null;
+    }
+    records.push({
+      sequence: blockOffset + i + 1,
+      studentName: names[index],
+      matricNumber: matricNumbers[i],
+      timestamp: timestamps[i],
+    });
+  }
+  return { sessionTag, offset: blockOffset, total, records };
+}
+
+export interface WriteOutcomeCount {
+  operation: number;
+  status: number;
+  count: number;
+}
+
+// Mirrors PowerState in esp32/include/power_manager.h.
+export const PowerState = {
+  Active: 0,
+  Tapering: 1,
+  Idle: 2,
+} as const;
+
+const POWER_STATE_COUNT = 3;
+
+export interface BeaconPower {
+  state: number;
+  lightSleep: boolean;
+  // Indexed by PowerState.
+  states: { seconds: number; estimatedMilliamps: number }[];
+}
+
+export interface BeaconMetrics {
+  uptimeSeconds: number;
+  freeHeap: number;
+  minimumFreeHeap: number;
+  largestFreeBlock: number;
+  connections: number;
+  logDrops: number;
+  journalDrops: number;
+  // Milliseconds after boot, 0 while not yet reached.
+  bootMilestones: { bleReady: number; advertising: number; restored: number };
+  power: BeaconPower;
+  outcomes: WriteOutcomeCount[];
+  // Per callback ID (esp32/include/metrics.h), sample counts per bucket.
+  latency: Record<number, number[]>;
+}
+
+const METRICS_FORMAT_VERSION = 2;
+const METRICS_LATENCY_BUCKETS = 8;
+
+// Upper bounds of the latency buckets in microseconds; the last is open.
+export const METRICS_BUCKET_BOUNDS_US = [
+  100, 250, 500, 1000, 2500, 5000, 10000, Infinity,
+];
+
+export function decodeMetrics(value: string): BeaconMetrics | null {
+  const bytes = base64ToBytes(value);
+  const fixedBytes = 1 + 4 + 12 + 1 + 8 + 12 + 2 + POWER_STATE_COUNT * 6 + 1;
+  if (bytes.length < fixedBytes || bytes[0] !== METRICS_FORMAT_VERSION) {
+    return null;
+  }
+
+  let offset = 1;
+  const u32 = () => {
+    const result = readUint32(bytes, offset);
+    offset += 4;
+    return result;
+  };
+  const uptimeSeconds = u32();
+  const freeHeap = u32();
+  const minimumFreeHeap = u32();
+  const largestFreeBlock = u32();
+  const connections = bytes[offset++];
+  const logDrops = u32();
+  const journalDrops = u32();
+  const bootMilestones = { bleReady: u32(), advertising: u32(), restored: u32() };
+
+  const power: BeaconPower = {
+    state: bytes[offset++],
+    lightSleep: (bytes[offset++] & 0x01) !== 0,
+    states: [],
+  };
+  for (let state = 0; state < POWER_STATE_COUNT; state++) {
+    const seconds = u32();
+    power.states.push({
+      seconds,
+      estimatedMilliamps: bytes[offset] | (bytes[offset + 1] << 8),
+    });
+    offset += 2;
+  }
+
+  const outcomeCount = bytes[offset++];
+  if (offset + outcomeCount * 6 + 1 > bytes.length) {
+    return null;
+  }
+  const outcomes: WriteOutcomeCount[] = [];
+  for (let i = 0; i < outcomeCount; i++) {
+    const operation = bytes[offset++];
+    const status = bytes[offset++];
+    outcomes.push({ operation, status, count: u32() });
+  }
+
+  const histogramCount = bytes[offset++];
+  const histogramBytes = 1 + METRICS_LATENCY_BUCKETS * 2;
+  if (offset + histogramCount * histogramBytes > bytes.length) {
+    return null;
+  }
+  const latency: Record<number, number[]> = {};
+  for (let i = 0; i < histogramCount; i++) {
+    const callback = bytes[offset++];
+    const counts: number[] = [];
+    for (let bucket = 0; bucket < METRICS_LATENCY_BUCKETS; bucket++) {
+      counts.push(bytes[offset] | (bytes[offset + 1] << 8));
+      offset += 2;
+    }
+    latency[callback] = counts;
+  }
+
+  return {
+    uptimeSeconds,
+    freeHeap,
+    minimumFreeHeap,
+    largestFreeBlock,
+    connections,
+    logDrops,
+    journalDrops,
+    bootMilestones,
+    power,
+    outcomes,
+    latency,
+  };
+}
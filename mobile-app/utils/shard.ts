@@ -0,0 +1,69 @@
+// Sharded halls run several beacons that share every session and merge
+// their attendance lists. They advertise as ESP32-Attendance-<n>of<count>,
+// n counting from 1; a lone beacon keeps the bare name. Students are spread
+// across the shards by a hash of their matric number, the same FNV-1a the
+// firmware uses (esp32/lib/attendance_core/include/shard_frames.h).
+
+export const BEACON_NAME = "ESP32-Attendance";
+
+export interface BeaconIdentity {
+  // Zero-based.
+  shard: number;
+  count: number;
+}
+
+const SHARD_NAME_PATTERN = new RegExp(`^${BEACON_NAME}(?:-(\\d+)of(\\d+))?$`);
+
+export function parseBeaconName(
+  name: string | null | undefined
+): BeaconIdentity | null {
+  const match = name ? SHARD_NAME_PATTERN.exec(name) : null;
+  if (!match) {
+    return null;
+  }
+  if (match[1] === undefined) {
+    return { shard: 0, count: 1 };
+  }
+  const shard = Number(match[1]) - 1;
+  const count = Number(match[2]);
+  return shard >= 0 && shard < count ? { shard, count } : null;
+}
+
+function utf8Bytes(text: string): number[] {
+  const bytes: number[] = [];
+  for (const char of text) {
+    const codePoint = char.codePointAt(0)!;
+    if (codePoint < 0x80) {
+      bytes.push(codePoint);
+    } else if (codePoint < 0x800) {
+      bytes.push(0xc0 | (codePoint >> 6), 0x80 | (codePoint & 0x3f));
+    } else if (codePoint < 0x10000) {
+      bytes.push(
+        0xe0 | (codePoint >> 12),
+        0x80 | ((codePoint >> 6) & 0x3f),
+        0x80 | (codePoint & 0x3f)
+      );
+    } else {
+      bytes.push(
+        0xf0 | (codePoint >> 18),
+        0x80 | ((codePoint >> 12) & 0x3f),
+        0x80 | ((codePoint >> 6) & 0x3f),
+        0x80 | (codePoint & 0x3f)
+      );
+    }
+  }
+  return bytes;
+}
+
+export function fnv1a(text: string): number {
+  let hash = 0x811c9dc5;
+  for (const byte of utf8Bytes(text)) {
+    hash ^= byte;
+    hash = Math.imul(hash, 0x01000193);
+  }
+  return hash >>> 0;
+}
+
+export function shardForMatric(matricNumber: string, count: number): number {
+  return count <= 1 ? 0 : fnv1a(matricNumber) % count;
+}
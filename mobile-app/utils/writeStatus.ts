@@ -0,0 +1,64 @@
+import { Device } from "react-native-ble-plx";
+import { decodeWriteStatus } from "./protocol";
+
+const WRITE_STATUS_TIMEOUT = 2000;
+
+// Runs a write and resolves with the beacon's status code for it, or null if
+// none arrived. The status is taken from the notification when the
+// subscription is up in time, otherwise from a readback.
+export function writeWithStatus(
+  device: Device,
+  serviceUUID: string,
+  statusUUID: string,
+  operation: number,
+  write: () => Promise<unknown>
+): Promise<number | null> {
+  return new Promise((resolve, reject) => {
+    let settled = false;
+    let timer: ReturnType<typeof setTimeout> | undefined;
+
+    const finish = (status: number | null) => {
+      if (settled) {
+        return;
+      }
+      settled = true;
+      clearTimeout(timer);
+      subscription.remove();
+      resolve(status);
+    };
+
+    const subscription = device.monitorCharacteristicForService(
+      serviceUUID,
+      statusUUID,
+      (error, characteristic) => {
+        if (error || !characteristic?.value) {
+          return;
+        }
+        const report = decodeWriteStatus(characteristic.value);
+        if (report && report.operation === operation) {
+          finish(report.status);
+        }
+      }
+    );
+
+    write()
+      .then(() => {
+        timer = setTimeout(() => {
+          device
+            .readCharacteristicForService(serviceUUID, statusUUID)
+            .then((characteristic) => {
+              const report = characteristic.value
+                ? decodeWriteStatus(characteristic.value)
+                : null;
+              finish(report && report.operation === operation ? report.status : null);
+            })
+            .catch(() => finish(null));
+        }, WRITE_STATUS_TIMEOUT);
+      })
+      .catch((error) => {
+        settled = true;
+        subscription.remove();
+        reject(error);
+      });
+  });
+}